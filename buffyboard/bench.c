@@ -0,0 +1,178 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+/* Development tool that runs the benchmarks and the soak test outside of the installed daemon */
+
+#include "benchmark.h"
+#include "buffyboard.h"
+#include "injection_benchmark.h"
+#include "soak.h"
+#include "terminal_benchmark.h"
+
+#include "lvgl/lvgl.h"
+
+#include "../shared/log.h"
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+
+/**
+ * Defines
+ */
+
+/* Identifiers of options without a short form */
+#define OPT_BENCHMARK 0x100
+#define OPT_SOAK 0x101
+#define OPT_BENCHMARK_TERMINAL 0x102
+#define OPT_BENCHMARK_INJECTION 0x103
+
+/* Default number of key presses in a soak test */
+#define DEFAULT_SOAK_PRESSES 1000000
+
+
+/**
+ * Static types
+ */
+
+/* Mode to run */
+typedef enum {
+    MODE_NONE,
+    MODE_BENCHMARK,
+    MODE_SOAK,
+    MODE_BENCHMARK_TERMINAL,
+    MODE_BENCHMARK_INJECTION
+} bench_mode;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Output usage instructions.
+ */
+static void print_usage();
+
+
+/**
+ * Static functions
+ */
+
+static void print_usage() {
+    fprintf(stderr,
+        /*-------------------------------- 78 CHARS --------------------------------*/
+        "Usage: buffyboard-bench [OPTION]\n"
+        "\n"
+        "Run exactly one of the following modes:\n"
+        "      --benchmark[=FILE]    Render the keyboard off-screen with every theme\n"
+        "                            at common resolutions, write the durations of\n"
+        "                            redraws, key presses, layer switches and\n"
+        "                            popovers as JSON to FILE (default: STDOUT) and\n"
+        "                            exit\n"
+        "      --soak[=N]            Simulate N random key presses, modifier\n"
+        "                            toggles and layer switches off-screen\n"
+        "                            (default: 1000000), fail if memory usage,\n"
+        "                            file descriptors or latency drift or keys\n"
+        "                            get stuck and exit\n"
+        "      --benchmark-terminal[=FILE]\n"
+        "                            Shrink and reset fake VTs with common console\n"
+        "                            sizes and fonts, write the durations, ioctls\n"
+        "                            and SIGWINCH signals per operation as JSON to\n"
+        "                            FILE (default: STDOUT) and exit\n"
+        "      --benchmark-injection[=FILE]\n"
+        "                            Type text and key combinations through the\n"
+        "                            default layout into a grabbed uinput device,\n"
+        "                            read them back, write the throughput in\n"
+        "                            characters per second and the number of lost\n"
+        "                            events as JSON to FILE (default: STDOUT) and\n"
+        "                            exit\n"
+        "\n"
+        "  -h, --help                Print this message and exit\n"
+        "  -v, --verbose             Enable more detailed logging output on STDERR\n"
+        "  -V, --version             Print the buffyboard version and exit\n");
+        /*-------------------------------- 78 CHARS --------------------------------*/
+}
+
+
+/**
+ * Main
+ */
+
+int main(int argc, char *argv[]) {
+    struct option long_opts[] = {
+        { "benchmark",           optional_argument, NULL, OPT_BENCHMARK },
+        { "soak",                optional_argument, NULL, OPT_SOAK },
+        { "benchmark-terminal",  optional_argument, NULL, OPT_BENCHMARK_TERMINAL },
+        { "benchmark-injection", optional_argument, NULL, OPT_BENCHMARK_INJECTION },
+        { "help",                no_argument,       NULL, 'h' },
+        { "verbose",             no_argument,       NULL, 'v' },
+        { "version",             no_argument,       NULL, 'V' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    bench_mode mode = MODE_NONE;
+    const char *file = NULL;
+    long soak_presses = DEFAULT_SOAK_PRESSES;
+    int opt, index = 0;
+
+    while ((opt = getopt_long(argc, argv, "hvV", long_opts, &index)) != -1) {
+        switch (opt) {
+        case OPT_BENCHMARK:
+            mode = MODE_BENCHMARK;
+            file = optarg;
+            break;
+        case OPT_SOAK:
+            mode = MODE_SOAK;
+            if (optarg && (sscanf(optarg, "%li", &soak_presses) != 1 || soak_presses <= 0)) {
+                bbx_log(BBX_LOG_LEVEL_ERROR, "Invalid soak argument \"%s\"\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_BENCHMARK_TERMINAL:
+            mode = MODE_BENCHMARK_TERMINAL;
+            file = optarg;
+            break;
+        case OPT_BENCHMARK_INJECTION:
+            mode = MODE_BENCHMARK_INJECTION;
+            file = optarg;
+            break;
+        case 'h':
+            print_usage();
+            exit(EXIT_SUCCESS);
+        case 'v':
+            bbx_log_set_level(BBX_LOG_LEVEL_VERBOSE);
+            break;
+        case 'V':
+            fprintf(stderr, "buffyboard-bench %s\n", PROJECT_VERSION);
+            exit(0);
+        default:
+            print_usage();
+            exit(EXIT_FAILURE);
+        }
+    }
+
+    switch (mode) {
+        case MODE_BENCHMARK:
+            lv_init();
+            lv_log_register_print_cb(bbx_log_print_cb);
+            return bb_benchmark_run(file) ? 0 : 1;
+        case MODE_SOAK:
+            lv_init();
+            lv_log_register_print_cb(bbx_log_print_cb);
+            return bb_soak_run(soak_presses) ? 0 : 1;
+        case MODE_BENCHMARK_TERMINAL:
+            return bb_terminal_benchmark_run(file) ? 0 : 1;
+        case MODE_BENCHMARK_INJECTION:
+            return bb_injection_benchmark_run(file) ? 0 : 1;
+        case MODE_NONE:
+            break;
+    }
+
+    print_usage();
+    return 1;
+}
@@ -0,0 +1,308 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "benchmark.h"
+
+#include "clock.h"
+#include "headless.h"
+#include "keyboard.h"
+#include "layout.h"
+#include "results.h"
+
+#include "lvgl/lvgl.h"
+
+#include "../shared/log.h"
+#include "../shared/theme.h"
+#include "../shared/themes.h"
+
+#include <stdlib.h>
+
+
+/**
+ * Defines
+ */
+
+/* Number of timed repetitions of each operation */
+#define NUM_ITERATIONS 50
+
+/* Number of untimed repetitions of each operation to warm up caches */
+#define NUM_WARMUP_ITERATIONS 5
+
+
+/**
+ * Static types
+ */
+
+/* Timed operation */
+typedef struct {
+    /* Name used in the results */
+    const char *name;
+    /* Function performing the operation once and returning its duration in µs */
+    uint64_t (*run)(lv_obj_t *keyboard);
+} operation;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Discard key events emitted by the keyboard.
+ *
+ * @param scancode the key's scancode
+ * @param pressed true for a key down event, false for a key up event
+ */
+static void key_cb(int scancode, bool pressed);
+
+/**
+ * Report the state of the virtual pointer.
+ *
+ * @param indev input device
+ * @param data pointer for writing the state into
+ */
+static void pointer_read_cb(lv_indev_t *indev, lv_indev_data_t *data);
+
+/**
+ * Move the virtual pointer, process the resulting input and render the changes.
+ *
+ * @param pressed true to press, false to release the pointer
+ * @return duration in µs
+ */
+static uint64_t set_pointer_state(bool pressed);
+
+/**
+ * Redraw the whole keyboard.
+ *
+ * @param keyboard keyboard widget
+ * @return duration in µs
+ */
+static uint64_t run_redraw(lv_obj_t *keyboard);
+
+/**
+ * Press a key.
+ *
+ * @param keyboard keyboard widget
+ * @return duration in µs
+ */
+static uint64_t run_key_press(lv_obj_t *keyboard);
+
+/**
+ * Release a previously pressed key.
+ *
+ * @param keyboard keyboard widget
+ * @return duration in µs
+ */
+static uint64_t run_key_release(lv_obj_t *keyboard);
+
+/**
+ * Switch between the default layer and another one.
+ *
+ * @param keyboard keyboard widget
+ * @return duration in µs
+ */
+static uint64_t run_layer_switch(lv_obj_t *keyboard);
+
+/**
+ * Compare two durations for sorting.
+ *
+ * @param a first duration
+ * @param b second duration
+ * @return negative, zero or positive value as required by qsort
+ */
+static int compare_durations(const void *a, const void *b);
+
+/**
+ * Time an operation and write its statistics to the results.
+ *
+ * @param results results file
+ * @param theme name of the current theme
+ * @param res current resolution
+ * @param name name of the operation
+ * @param run function performing the operation
+ * @param keyboard keyboard widget
+ */
+static void measure(bb_results *results, const char *theme, const bb_headless_resolution *res, const char *name,
+    uint64_t (*run)(lv_obj_t *), lv_obj_t *keyboard);
+
+
+/**
+ * Static variables
+ */
+
+static lv_display_t *display = NULL;
+static lv_indev_t *pointer = NULL;
+static lv_point_t pointer_point = { 0, 0 };
+static lv_indev_state_t pointer_state = LV_INDEV_STATE_RELEASED;
+
+
+/**
+ * Static functions
+ */
+
+static void key_cb(int scancode, bool pressed) {
+}
+
+static void pointer_read_cb(lv_indev_t *indev, lv_indev_data_t *data) {
+    data->point = pointer_point;
+    data->state = pointer_state;
+}
+
+static uint64_t set_pointer_state(bool pressed) {
+    /* Aim at the first key of the second row, which is a letter key on the default layer */
+    pointer_point.x = lv_display_get_horizontal_resolution(display) / 20;
+    pointer_point.y = lv_display_get_vertical_resolution(display) * 3 / 10;
+    pointer_state = pressed ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED;
+
+    uint64_t start = bb_clock_now();
+    lv_indev_read(pointer);
+    lv_refr_now(display);
+    return bb_clock_now() - start;
+}
+
+static uint64_t run_redraw(lv_obj_t *keyboard) {
+    uint64_t start = bb_clock_now();
+    lv_obj_invalidate(keyboard);
+    lv_refr_now(display);
+    return bb_clock_now() - start;
+}
+
+static uint64_t run_key_press(lv_obj_t *keyboard) {
+    return set_pointer_state(true);
+}
+
+static uint64_t run_key_release(lv_obj_t *keyboard) {
+    return set_pointer_state(false);
+}
+
+static uint64_t run_layer_switch(lv_obj_t *keyboard) {
+    const bb_layout_layer *layer = &bb_layout_get_current()->layers[bb_layout_get_current_layer_index()];
+
+    /* Alternate between the default layer and the first one reachable from it */
+    int dest = -1;
+    for (int i = 0; i < layer->num_keys && dest != 0; ++i) {
+        if ((layer->keys[i].flags & BB_LAYOUT_KEY_SWITCHER) && (dest < 0 || layer->keys[i].dest_layer == 0)) {
+            dest = layer->keys[i].dest_layer;
+        }
+    }
+    if (dest < 0) {
+        return 0;
+    }
+
+    uint64_t start = bb_clock_now();
+    bb_keyboard_set_layer(keyboard, dest);
+    lv_refr_now(display);
+    return bb_clock_now() - start;
+}
+
+static int compare_durations(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static void measure(bb_results *results, const char *theme, const bb_headless_resolution *res, const char *name,
+        uint64_t (*run)(lv_obj_t *), lv_obj_t *keyboard) {
+    uint64_t durations[NUM_ITERATIONS];
+    uint64_t total = 0;
+
+    for (int i = 0; i < NUM_WARMUP_ITERATIONS; ++i) {
+        run(keyboard);
+    }
+
+    /* Walking LVGL's pool is slow, so memory is only compared across all timed iterations. Anything that an
+     * operation keeps allocated, such as a widget rebuilt on every layer switch that isn't freed, shows up here. */
+    lv_mem_monitor_t before;
+    lv_mem_monitor(&before);
+
+    for (int i = 0; i < NUM_ITERATIONS; ++i) {
+        durations[i] = run(keyboard);
+        total += durations[i];
+    }
+    qsort(durations, NUM_ITERATIONS, sizeof(uint64_t), compare_durations);
+
+    lv_mem_monitor_t after;
+    lv_mem_monitor(&after);
+
+    bb_results_add(results, "\"theme\":\"%s\",\"resolution\":\"%dx%d\",\"operation\":\"%s\","
+        "\"min_us\":%llu,\"median_us\":%llu,\"mean_us\":%llu,\"max_us\":%llu,"
+        "\"pool_blocks_delta\":%d,\"pool_bytes_delta\":%lld",
+        theme, res->width, res->height, name,
+        (unsigned long long)durations[0], (unsigned long long)durations[NUM_ITERATIONS / 2],
+        (unsigned long long)(total / NUM_ITERATIONS), (unsigned long long)durations[NUM_ITERATIONS - 1],
+        (int)after.used_cnt - (int)before.used_cnt,
+        (long long)before.free_size - (long long)after.free_size);
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_benchmark_run(const char *path) {
+    bb_results results;
+    if (!bb_results_open(&results, path, NUM_ITERATIONS, NULL)) {
+        return false;
+    }
+
+    /* Pressing and releasing a key shows and hides its popover once popovers are enabled, so the same
+     * operations are timed once with and once without them */
+    const operation operations[] = {
+        { "redraw", run_redraw },
+        { "key_press", run_key_press },
+        { "key_release", run_key_release },
+        { "layer_switch", run_layer_switch },
+        { "popover_show", run_key_press },
+        { "popover_hide", run_key_release }
+    };
+    const int num_operations = sizeof(operations) / sizeof(operations[0]);
+    const int first_popover_operation = 4;
+
+    bool success = true;
+    for (int t = 0; bbx_themes_themes[t] != NULL; ++t) {
+        for (int r = 0; r < bb_headless_num_resolutions; ++r) {
+            const bb_headless_resolution *res = &bb_headless_resolutions[r];
+
+            /* Only the keyboard's part of the screen is rendered, just like on a real device */
+            int32_t height = res->height / bb_keyboard_height_denominator(res->width, res->height);
+            display = bb_headless_display_create(res->width, height);
+            if (!display) {
+                success = false;
+                break;
+            }
+
+            pointer = lv_indev_create();
+            lv_indev_set_type(pointer, LV_INDEV_TYPE_POINTER);
+            lv_indev_set_read_cb(pointer, pointer_read_cb);
+            lv_indev_set_display(pointer, display);
+            lv_timer_pause(lv_indev_get_read_timer(pointer));
+            pointer_state = LV_INDEV_STATE_RELEASED;
+
+            bbx_theme_apply(bbx_themes_themes[t]);
+            lv_obj_t *keyboard = bb_keyboard_create(lv_display_get_screen_active(display), bb_layout_default_name,
+                key_cb);
+            lv_refr_now(display);
+
+            for (int o = 0; o < num_operations; ++o) {
+                if (o == first_popover_operation) {
+                    /* Return to the default layer so that the pointer hits a letter key */
+                    bb_keyboard_set_layer(keyboard, 0);
+                    bb_keyboard_set_popovers(keyboard, true);
+                }
+                measure(&results, bbx_themes_themes[t]->name, res, operations[o].name, operations[o].run,
+                    keyboard);
+            }
+
+            lv_indev_delete(pointer);
+            bb_headless_display_delete(display);
+        }
+    }
+
+    if (!bb_results_close(&results)) {
+        return false;
+    }
+
+    return success;
+}
@@ -0,0 +1,21 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_BENCHMARK_H
+#define BB_BENCHMARK_H
+
+#include <stdbool.h>
+
+/**
+ * Render the keyboard off-screen with every theme at every screenshot resolution and write the durations of
+ * common rendering operations as JSON. LVGL must have been initialised beforehand.
+ *
+ * @param path path of the file to write the results to or NULL to write them to STDOUT
+ * @return true on success, false otherwise
+ */
+bool bb_benchmark_run(const char *path);
+
+#endif /* BB_BENCHMARK_H */
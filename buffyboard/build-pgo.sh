@@ -0,0 +1,122 @@
+#!/bin/bash
+
+# Copyright 2026 Johannes Marbach
+# SPDX-License-Identifier: GPL-3.0-or-later
+
+
+# Build buffyboard with link-time and profile-guided optimisation. The instrumented build is trained with the
+# off-screen rendering benchmark and a soak test from buffyboard-bench, which together cover rendering, key handling
+# and layer switches. Both executables link the same static library, so the profile applies to the daemon.
+
+set -e
+
+root=$(git rev-parse --show-toplevel)
+builddir=$root/_build-pgo
+refdir=$root/_build-ref
+cross_file=
+use_only=false
+soak_presses=200000
+
+function usage() {
+    cat << EOF 1>&2
+Usage: $0 [-b DIR] [-x CROSS_FILE] [-u]
+
+  -b DIR         Build directory (default: $builddir)
+  -x CROSS_FILE  Cross build with the given meson cross file (e.g.
+                 buffyboard/arm64.txt). The training has to run on the target
+                 device in that case, so the script stops after the
+                 instrumented build and explains how to collect the profile.
+  -u             Skip the instrumented build and training and build with the
+                 profile that is already in the build directory
+EOF
+}
+
+while getopts "b:x:uh" opt; do
+    case $opt in
+        b) builddir=$(realpath -m "$OPTARG");;
+        x) cross_file=$(realpath "$OPTARG");;
+        u) use_only=true;;
+        *) usage; exit 1;;
+    esac
+done
+
+cross_args=()
+if [[ -n $cross_file ]]; then
+    cross_args=(--cross-file "$cross_file")
+fi
+
+function train() {
+    "$1" --benchmark=/dev/null
+    "$1" --soak=$soak_presses 2> /dev/null
+}
+
+function measure() {
+    "$1" --benchmark="$2"
+    "$1" --soak=$soak_presses 2>&1 | grep -o "[0-9]* µs per key" | tail -n 1 | cut -d ' ' -f 1 > "$2.latency"
+}
+
+# Sum the median durations of an operation over all themes and resolutions
+function sum_medians() {
+    grep "\"operation\":\"$2\"" "$1" | grep -o '"median_us":[0-9]*' | cut -d: -f2 | awk '{ s += $1 } END { print s }'
+}
+
+function improvement() {
+    awk -v ref="$1" -v opt="$2" 'BEGIN { if (ref > 0) printf "%.1f%%", (ref - opt) * 100 / ref; else print "n/a" }'
+}
+
+cd "$root"
+
+if [[ $use_only == false ]]; then
+    echo "Building instrumented binary in $builddir"
+    rm -rf "$builddir"
+    meson setup "$builddir" --buildtype=release -Db_lto=true -Db_pgo=generate "${cross_args[@]}"
+    meson compile -C "$builddir"
+
+    if [[ -n $cross_file ]]; then
+        # GCC writes the profile next to the object files, so strip the build directory when running elsewhere
+        strip=$(echo "$builddir" | tr -cd / | wc -c)
+        echo
+        echo "Copy $builddir/buffyboard/buffyboard-bench to the target device and run there:"
+        echo
+        echo "  export GCOV_PREFIX=/tmp/buffyboard-pgo GCOV_PREFIX_STRIP=$strip"
+        echo "  ./buffyboard-bench --benchmark=/dev/null"
+        echo "  ./buffyboard-bench --soak=$soak_presses"
+        echo
+        echo "Then copy the contents of /tmp/buffyboard-pgo into $builddir and run"
+        echo
+        echo "  $0 -b $builddir -x $cross_file -u"
+        echo
+        echo "The profile stays valid for as long as neither the sources nor the compiler change."
+        exit 0
+    fi
+
+    echo "Training"
+    train "$builddir/buffyboard/buffyboard-bench"
+fi
+
+echo "Building optimised binary in $builddir"
+meson configure "$builddir" -Db_pgo=use
+meson compile -C "$builddir"
+
+if [[ -n $cross_file ]]; then
+    exit 0
+fi
+
+echo "Building reference binary in $refdir"
+rm -rf "$refdir"
+meson setup "$refdir" --buildtype=release
+meson compile -C "$refdir"
+
+echo "Comparing"
+measure "$refdir/buffyboard/buffyboard-bench" "$refdir/benchmark.json"
+measure "$builddir/buffyboard/buffyboard-bench" "$builddir/benchmark.json"
+
+printf "%-14s %13s %13s %12s\n" "operation" "default" "pgo+lto" "improvement"
+for op in redraw key_press key_release layer_switch popover_show popover_hide; do
+    ref=$(sum_medians "$refdir/benchmark.json" $op)
+    opt=$(sum_medians "$builddir/benchmark.json" $op)
+    printf "%-14s %10s µs %10s µs %12s\n" $op "$ref" "$opt" "$(improvement "$ref" "$opt")"
+done
+ref=$(cat "$refdir/benchmark.json.latency")
+opt=$(cat "$builddir/benchmark.json.latency")
+printf "%-14s %10s µs %10s µs %12s\n" "key latency" "$ref" "$opt" "$(improvement "$ref" "$opt")"
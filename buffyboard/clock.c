@@ -0,0 +1,20 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "clock.h"
+
+#include <time.h>
+
+
+/**
+ * Public functions
+ */
+
+uint64_t bb_clock_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + (uint64_t)ts.tv_nsec / 1000;
+}
@@ -0,0 +1,19 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_CLOCK_H
+#define BB_CLOCK_H
+
+#include <stdint.h>
+
+/**
+ * Get the current time from the monotonic clock. Can be called from any thread.
+ *
+ * @return time in µs
+ */
+uint64_t bb_clock_now(void);
+
+#endif /* BB_CLOCK_H */
@@ -7,6 +7,7 @@
 #include "command_line.h"
 
 #include "buffyboard.h"
+#include "control.h"
 
 #include "../shared/log.h"
 
@@ -15,6 +16,21 @@
 #include <stdlib.h>
 
 
+/**
+ * Defines
+ */
+
+/* Identifiers of options without a short form */
+#define OPT_STARTUP_TRACE 0x100
+#define OPT_STATS 0x101
+#define OPT_TRACE 0x102
+#define OPT_EXPORT_LAYOUTS 0x103
+#define OPT_CONTROL_SOCKET 0x104
+
+/* Default interval in seconds for logging performance statistics */
+#define DEFAULT_STATS_INTERVAL 10
+
+
 /**
  * Static prototypes
  */
@@ -46,6 +62,11 @@ static void init_opts(bb_cli_opts *opts) {
     opts->dpi = 0;
     opts->rotation = LV_DISPLAY_ROTATION_0;
     opts->verbose = false;
+    opts->startup_trace = false;
+    opts->stats_interval = 0;
+    opts->trace_file = NULL;
+    opts->export_layouts_dir = NULL;
+    opts->control_socket = BB_CONTROL_DEFAULT_PATH;
 }
 
 static void print_usage() {
@@ -75,7 +96,20 @@ static void print_usage() {
         "                            * 3 - counterclockwise orientation (270 degrees)\n"
         "  -h, --help                Print this message and exit\n"
         "  -v, --verbose             Enable more detailed logging output on STDERR\n"
-        "  -V, --version             Print the buffyboard version and exit\n");
+        "  -V, --version             Print the buffyboard version and exit\n"
+        "      --startup-trace       Print the duration of each startup phase and\n"
+        "                            the time to the first frame on STDERR\n"
+        "      --stats[=N]           Log frame rate, render and flush times, CPU\n"
+        "                            and memory usage and key events every N\n"
+        "                            seconds (default: 10)\n"
+        "      --trace=FILE          Record input, rendering and key events and\n"
+        "                            write them to FILE in Chrome's trace event\n"
+        "                            format on exit or SIGUSR1\n"
+        "      --export-layouts=DIR  Compile the built-in layouts into layout files\n"
+        "                            in DIR and exit\n"
+        "      --control-socket=PATH Accept commands on the UNIX domain socket PATH\n"
+        "                            (default: " BB_CONTROL_DEFAULT_PATH "). Pass an\n"
+        "                            empty PATH to disable the socket.\n");
         /*-------------------------------- 78 CHARS --------------------------------*/
 }
 
@@ -95,6 +129,11 @@ void bb_cli_parse_opts(int argc, char *argv[], bb_cli_opts *opts) {
         { "help",            no_argument,       NULL, 'h' },
         { "verbose",         no_argument,       NULL, 'v' },
         { "version",         no_argument,       NULL, 'V' },
+        { "startup-trace",   no_argument,       NULL, OPT_STARTUP_TRACE },
+        { "stats",           optional_argument, NULL, OPT_STATS },
+        { "trace",           required_argument, NULL, OPT_TRACE },
+        { "export-layouts",  required_argument, NULL, OPT_EXPORT_LAYOUTS },
+        { "control-socket",  required_argument, NULL, OPT_CONTROL_SOCKET },
         { NULL, 0, NULL, 0 }
     };
 
@@ -156,6 +195,25 @@ void bb_cli_parse_opts(int argc, char *argv[], bb_cli_opts *opts) {
         case 'V':
             fprintf(stderr, "buffyboard %s\n", PROJECT_VERSION);
             exit(0);
+        case OPT_STARTUP_TRACE:
+            opts->startup_trace = true;
+            break;
+        case OPT_STATS:
+            opts->stats_interval = DEFAULT_STATS_INTERVAL;
+            if (optarg && (sscanf(optarg, "%i", &(opts->stats_interval)) != 1 || opts->stats_interval <= 0)) {
+                bbx_log(BBX_LOG_LEVEL_ERROR, "Invalid stats interval argument \"%s\"\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case OPT_TRACE:
+            opts->trace_file = optarg;
+            break;
+        case OPT_EXPORT_LAYOUTS:
+            opts->export_layouts_dir = optarg;
+            break;
+        case OPT_CONTROL_SOCKET:
+            opts->control_socket = optarg;
+            break;
         default:
             print_usage();
             exit(EXIT_FAILURE);
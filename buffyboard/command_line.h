@@ -31,6 +31,16 @@ typedef struct {
     lv_display_rotation_t rotation;
     /* Verbose mode. If true, provide more detailed logging output on STDERR. */
     bool verbose;
+    /* If true, print the duration of each startup phase and the time to the first frame on STDERR */
+    bool startup_trace;
+    /* Interval in seconds for logging performance statistics or 0 to disable them */
+    int stats_interval;
+    /* Path of the file to write a trace to or NULL to disable tracing */
+    const char *trace_file;
+    /* Directory to compile the built-in layouts into or NULL to run normally */
+    const char *export_layouts_dir;
+    /* Path of the control socket or an empty string to disable it */
+    const char *control_socket;
 } bb_cli_opts;
 
 /**
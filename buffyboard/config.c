@@ -6,13 +6,17 @@
 
 #include "config.h"
 
+#include "layout.h"
+
 #include "../shared/config.h"
 #include "../shared/log.h"
-#include "../squeek2lvgl/sq2lv.h"
 
 #include "lvgl/lvgl.h"
 
+#include <errno.h>
 #include <ini.h>
+#include <limits.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -32,6 +36,15 @@
  */
 static int parsing_handler(void* user_data, const char* section, const char* key, const char* value);
 
+/**
+ * Parse a non-negative integer.
+ *
+ * @param value string to parse
+ * @param result pointer for writing the parsed value into
+ * @return true if parsing was successful, false otherwise
+ */
+static bool parse_uint(const char *value, int *result);
+
 
 /**
  * Static functions
@@ -48,8 +61,23 @@ static int parsing_handler(void* user_data, const char* section, const char* key
                 return 1;
             }
         }
+    } else if (strcmp(section, "layout") == 0) {
+        if (strcmp(key, "default") == 0) {
+            if (strlen(value) > 0 && strlen(value) < sizeof(opts->layout.default_name)) {
+                strcpy(opts->layout.default_name, value);
+                return 1;
+            }
+        }
     } else if (strcmp(section, "input") == 0) {
-        if (strcmp(key, "pointer") == 0) {
+        if (strcmp(key, "backend") == 0) {
+            if (strcmp(value, "libinput") == 0) {
+                opts->input.backend = BB_CONFIG_INPUT_BACKEND_LIBINPUT;
+                return 1;
+            } else if (strcmp(value, "evdev") == 0) {
+                opts->input.backend = BB_CONFIG_INPUT_BACKEND_EVDEV;
+                return 1;
+            }
+        } else if (strcmp(key, "pointer") == 0) {
             if (bbx_config_parse_bool(value, &(opts->input.pointer))) {
                 return 1;
             }
@@ -57,6 +85,38 @@ static int parsing_handler(void* user_data, const char* section, const char* key
             if (bbx_config_parse_bool(value, &(opts->input.touchscreen))) {
                 return 1;
             }
+        } else if (strcmp(key, "hide_on_hardware_keyboard") == 0) {
+            if (bbx_config_parse_bool(value, &(opts->input.hide_on_hardware_keyboard))) {
+                return 1;
+            }
+        }
+    } else if (strcmp(section, "terminal") == 0) {
+        if (strcmp(key, "eager_resize") == 0) {
+            if (bbx_config_parse_bool(value, &(opts->terminal.eager_resize))) {
+                return 1;
+            }
+        }
+    } else if (strcmp(section, "performance") == 0) {
+        if (strcmp(key, "refresh_period") == 0) {
+            if (parse_uint(value, &(opts->performance.refresh_period))) {
+                return 1;
+            }
+        } else if (strcmp(key, "input_read_period") == 0) {
+            if (parse_uint(value, &(opts->performance.input_read_period))) {
+                return 1;
+            }
+        } else if (strcmp(key, "draw_buffer_lines") == 0) {
+            if (parse_uint(value, &(opts->performance.draw_buffer_lines))) {
+                return 1;
+            }
+        } else if (strcmp(key, "memory_pool_size") == 0) {
+            if (parse_uint(value, &(opts->performance.memory_pool_size))) {
+                return 1;
+            }
+        } else if (strcmp(key, "image_cache_size") == 0) {
+            if (parse_uint(value, &(opts->performance.image_cache_size))) {
+                return 1;
+            }
         }
     } else if (strcmp(section, "quirks") == 0) {
         if (strcmp(key, "fbdev_force_refresh") == 0) {
@@ -70,6 +130,17 @@ static int parsing_handler(void* user_data, const char* section, const char* key
     return 1; /* Return 1 (true) so that we can use the return value of ini_parse exclusively for file-level errors (e.g. file not found) */
 }
 
+static bool parse_uint(const char *value, int *result) {
+    char *end = NULL;
+    errno = 0;
+    long parsed = strtol(value, &end, 10);
+    if (errno != 0 || end == value || *end != '\0' || parsed < 0 || parsed > INT_MAX) {
+        return false;
+    }
+    *result = (int)parsed;
+    return true;
+}
+
 
 /**
  * Public functions
@@ -77,8 +148,17 @@ static int parsing_handler(void* user_data, const char* section, const char* key
 
 void bb_config_init_opts(bb_config_opts *opts) {
     opts->theme.default_id = BBX_THEMES_THEME_BREEZY_DARK;
+    snprintf(opts->layout.default_name, sizeof(opts->layout.default_name), "%s", bb_layout_default_name);
+    opts->input.backend = BB_CONFIG_INPUT_BACKEND_LIBINPUT;
     opts->input.pointer = true;
     opts->input.touchscreen = true;
+    opts->input.hide_on_hardware_keyboard = false;
+    opts->terminal.eager_resize = false;
+    opts->performance.refresh_period = 0;
+    opts->performance.input_read_period = 0;
+    opts->performance.draw_buffer_lines = 0;
+    opts->performance.memory_pool_size = 0;
+    opts->performance.image_cache_size = 0;
     opts->quirks.fbdev_force_refresh = false;
 }
 
@@ -9,8 +9,6 @@
 
 #include "../shared/themes.h"
 
-#include "sq2lv_layouts.h"
-
 /**
  * Options related to the theme
  */
@@ -19,16 +17,62 @@ typedef struct {
     bbx_themes_theme_id_t default_id;
 } bb_config_opts_theme;
 
+/**
+ * Options related to the keyboard layout
+ */
+typedef struct {
+    /* Short name of the default layout (e.g. "terminal/us") */
+    char default_name[64];
+} bb_config_opts_layout;
+
+/**
+ * Backends for reading input devices
+ */
+typedef enum {
+    /* Connect all matching devices through libinput and udev */
+    BB_CONFIG_INPUT_BACKEND_LIBINPUT = 0,
+    /* Read a single touchscreen directly from its evdev node */
+    BB_CONFIG_INPUT_BACKEND_EVDEV = 1
+} bb_config_input_backend;
+
 /**
  * Options related to input devices
  */
 typedef struct {
+    /* Backend for reading input devices */
+    bb_config_input_backend backend;
     /* If true and a pointer device is connected, use it for input */
     bool pointer;
     /* If true and a touchscreen device is connected, use it for input */
     bool touchscreen;
+    /* If true, hide the keyboard while a hardware keyboard is connected */
+    bool hide_on_hardware_keyboard;
 } bb_config_opts_input;
 
+/**
+ * Options related to terminal resizing
+ */
+typedef struct {
+    /* If true, shrink all allocated VTs up front rather than only the active one when it's shown */
+    bool eager_resize;
+} bb_config_opts_terminal;
+
+/**
+ * Options for tuning performance and memory usage. A value of 0 keeps the default compiled into LVGL.
+ */
+typedef struct {
+    /* Display refresh period in ms */
+    int refresh_period;
+    /* Input device read period in ms */
+    int input_read_period;
+    /* Height of the draw buffer in lines */
+    int draw_buffer_lines;
+    /* Size in KiB of additional memory to make available to LVGL's allocator */
+    int memory_pool_size;
+    /* Size in KiB of the image cache */
+    int image_cache_size;
+} bb_config_opts_performance;
+
 /**
  * (Normally unneeded) quirky options
  */
@@ -43,8 +87,14 @@ typedef struct {
 typedef struct {
     /* Options related to the theme */
     bb_config_opts_theme theme;
+    /* Options related to the keyboard layout */
+    bb_config_opts_layout layout;
     /* Options related to input devices */
     bb_config_opts_input input;
+    /* Options related to terminal resizing */
+    bb_config_opts_terminal terminal;
+    /* Options for tuning performance and memory usage */
+    bb_config_opts_performance performance;
     /* Options related to (normally unneeded) quirks */
     bb_config_opts_quirks quirks;
 } bb_config_opts;
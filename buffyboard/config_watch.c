@@ -0,0 +1,209 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "config_watch.h"
+
+#include "main_loop.h"
+
+#include "../shared/log.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/inotify.h>
+
+
+/**
+ * Defines
+ */
+
+/* Maximum number of watched directory entries */
+#define MAX_WATCHES 32
+
+/* Events that indicate a changed configuration file. IN_CREATE is only used for directories because new files
+ * are reported again with IN_CLOSE_WRITE once they've been written. */
+#define WATCH_MASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_CREATE | IN_ONLYDIR)
+
+
+/**
+ * Static types
+ */
+
+/* Watched directory entry */
+typedef struct {
+    /* inotify watch descriptor or -1 if the directory doesn't currently exist */
+    int wd;
+    /* Directory containing the entry */
+    char dir[PATH_MAX];
+    /* Name of the entry within the directory or empty to match any entry */
+    char name[NAME_MAX + 1];
+} watch_entry;
+
+
+/**
+ * Static variables
+ */
+
+static int inotify_fd = -1;
+static bb_config_watch_cb callback = NULL;
+static watch_entry entries[MAX_WATCHES];
+static int num_entries = 0;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Register a directory entry for watching.
+ *
+ * @param dir directory containing the entry
+ * @param name name of the entry or NULL to match any entry in the directory
+ */
+static void add_entry(const char *dir, const char *name);
+
+/**
+ * Register a file path for watching.
+ *
+ * @param path path of the file
+ */
+static void add_file(const char *path);
+
+/**
+ * (Re-)add inotify watches for all registered entries. Directories that didn't exist before may have been
+ * created and previously watched ones may have been replaced.
+ */
+static void refresh_watches(void);
+
+/**
+ * Test if an inotify event concerns one of the registered entries.
+ *
+ * @param event inotify event
+ * @return true if the event is relevant, false otherwise
+ */
+static bool is_relevant(const struct inotify_event *event);
+
+/**
+ * Handle changes in the watched directories.
+ *
+ * @param fd inotify file descriptor
+ * @param user_data unused
+ */
+static void inotify_cb(int fd, void *user_data);
+
+
+/**
+ * Static functions
+ */
+
+static void add_entry(const char *dir, const char *name) {
+    if (num_entries >= MAX_WATCHES) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not watch %s/%s, too many watches", dir, name ? name : "");
+        return;
+    }
+
+    watch_entry *entry = &entries[num_entries++];
+    entry->wd = -1;
+    snprintf(entry->dir, sizeof(entry->dir), "%s", dir);
+    snprintf(entry->name, sizeof(entry->name), "%s", name ? name : "");
+}
+
+static void add_file(const char *path) {
+    const char *slash = strrchr(path, '/');
+    if (!slash) {
+        add_entry(".", path);
+        return;
+    }
+
+    char dir[PATH_MAX];
+    snprintf(dir, sizeof(dir), "%.*s", (int)(slash - path), path);
+    add_entry(slash == path ? "/" : dir, slash + 1);
+}
+
+static void refresh_watches(void) {
+    /* Adding a watch for an already watched directory returns the existing descriptor */
+    for (int i = 0; i < num_entries; ++i) {
+        entries[i].wd = inotify_add_watch(inotify_fd, entries[i].dir, WATCH_MASK);
+    }
+}
+
+static bool is_relevant(const struct inotify_event *event) {
+    if (event->len == 0 || ((event->mask & IN_CREATE) && !(event->mask & IN_ISDIR))) {
+        return false;
+    }
+
+    for (int i = 0; i < num_entries; ++i) {
+        if (entries[i].wd == event->wd && (entries[i].name[0] == '\0' || strcmp(entries[i].name, event->name) == 0)) {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void inotify_cb(int fd, void *user_data) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+            changed |= is_relevant(event);
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    if (!changed) {
+        return;
+    }
+
+    /* A .conf.d directory might have been created or removed */
+    refresh_watches();
+
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Configuration changed, reloading");
+    callback();
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_config_watch_init(const char **override_files, int num_override_files, bb_config_watch_cb cb) {
+    callback = cb;
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not create inotify instance: %s", strerror(errno));
+        return false;
+    }
+
+    /* Watch the parent directories for the .conf.d directories themselves so that they can be picked up
+     * when they're created later */
+    add_entry("/usr/share/buffyboard", "buffyboard.conf");
+    add_entry("/usr/share/buffyboard", "buffyboard.conf.d");
+    add_entry("/usr/share/buffyboard/buffyboard.conf.d", NULL);
+    add_entry("/etc", "buffyboard.conf");
+    add_entry("/etc", "buffyboard.conf.d");
+    add_entry("/etc/buffyboard.conf.d", NULL);
+    for (int i = 0; i < num_override_files; ++i) {
+        add_file(override_files[i]);
+    }
+
+    refresh_watches();
+
+    if (!bb_main_loop_add_fd(inotify_fd, inotify_cb, NULL)) {
+        close(inotify_fd);
+        inotify_fd = -1;
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,28 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_CONFIG_WATCH_H
+#define BB_CONFIG_WATCH_H
+
+#include <stdbool.h>
+
+/**
+ * Callback for changes to any of the watched configuration files.
+ */
+typedef void (*bb_config_watch_cb)(void);
+
+/**
+ * Watch the default configuration locations and a list of override files for changes. Requires the main loop
+ * to be initialised.
+ *
+ * @param override_files paths to configuration override files
+ * @param num_override_files number of configuration override files
+ * @param cb callback to invoke from the main loop after files were written, replaced or removed
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_config_watch_init(const char **override_files, int num_override_files, bb_config_watch_cb cb);
+
+#endif /* BB_CONFIG_WATCH_H */
@@ -0,0 +1,332 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "control.h"
+
+#include "main_loop.h"
+
+#include "../shared/log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+
+/**
+ * Defines
+ */
+
+/* Maximum number of simultaneously connected clients. Each one takes up a main loop watch. */
+#define MAX_CLIENTS 4
+
+/* Size of each client's receive buffer, which limits the length of a command */
+#define BUFFER_SIZE 4096
+
+/* Maximum length of a reply including the status */
+#define MAX_REPLY 1024
+
+
+/**
+ * Static types
+ */
+
+/* Connected client */
+typedef struct {
+    /* Socket or -1 if the slot is free */
+    int fd;
+    /* Received data that doesn't form a complete line yet */
+    char buffer[BUFFER_SIZE];
+    /* Number of bytes in the buffer */
+    size_t length;
+    /* Whether the rest of an overlong line is being dropped */
+    bool is_discarding;
+} client;
+
+
+/**
+ * Static variables
+ */
+
+static int listen_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un *)NULL)->sun_path)];
+static bb_control_cb callback = NULL;
+static client clients[MAX_CLIENTS];
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Check whether another process is already listening on a socket.
+ *
+ * @param addr address of the socket
+ * @return true if a connection could be established, false otherwise
+ */
+static bool is_in_use(const struct sockaddr_un *addr);
+
+/**
+ * Disconnect a client and free its slot.
+ *
+ * @param c client to disconnect
+ */
+static void close_client(client *c);
+
+/**
+ * Send a line to a client without blocking. Clients that don't keep up with reading their replies are
+ * disconnected.
+ *
+ * @param c client to send to
+ * @param line line including the trailing newline
+ * @param length length of the line
+ * @return true if the line was sent, false if the client was disconnected
+ */
+static bool send_line(client *c, const char *line, size_t length);
+
+/**
+ * Run a single command and send the reply.
+ *
+ * @param c client that sent the command
+ * @param line command line without the trailing newline
+ * @return true if the reply was sent, false if the client was disconnected
+ */
+static bool run_command(client *c, char *line);
+
+/**
+ * Accept pending connections.
+ *
+ * @param fd listening socket
+ * @param user_data unused
+ */
+static void accept_cb(int fd, void *user_data);
+
+/**
+ * Read from a client and run all complete commands.
+ *
+ * @param fd client socket
+ * @param user_data the client
+ */
+static void client_cb(int fd, void *user_data);
+
+
+/**
+ * Static functions
+ */
+
+static bool is_in_use(const struct sockaddr_un *addr) {
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    bool in_use = connect(fd, (const struct sockaddr *)addr, sizeof(*addr)) == 0;
+    close(fd);
+    return in_use;
+}
+
+static void close_client(client *c) {
+    bb_main_loop_remove_fd(c->fd);
+    close(c->fd);
+    c->fd = -1;
+    c->length = 0;
+    c->is_discarding = false;
+}
+
+static bool send_line(client *c, const char *line, size_t length) {
+    ssize_t sent = send(c->fd, line, length, MSG_NOSIGNAL | MSG_DONTWAIT);
+    if (sent != (ssize_t)length) {
+        bbx_log(BBX_LOG_LEVEL_VERBOSE, "Disconnecting control client that doesn't read its replies");
+        close_client(c);
+        return false;
+    }
+    return true;
+}
+
+static bool run_command(client *c, char *line) {
+    size_t length = strlen(line);
+    if (length > 0 && line[length - 1] == '\r') {
+        line[--length] = '\0';
+    }
+
+    /* Ignore empty lines so that clients can use them as keep-alives */
+    if (length == 0) {
+        return true;
+    }
+
+    char *arg = strchr(line, ' ');
+    if (arg) {
+        *arg++ = '\0';
+    } else {
+        arg = line + length;
+    }
+
+    char reply[MAX_REPLY - 8] = "";
+    bool success = callback(line, arg, reply, sizeof(reply));
+
+    char buffer[MAX_REPLY];
+    int len = snprintf(buffer, sizeof(buffer), "%s%s%s\n", success ? "ok" : "error", reply[0] ? " " : "", reply);
+    return send_line(c, buffer, len);
+}
+
+static void accept_cb(int fd, void *user_data) {
+    int client_fd;
+    while ((client_fd = accept(fd, NULL, NULL)) >= 0) {
+        fcntl(client_fd, F_SETFD, FD_CLOEXEC);
+        fcntl(client_fd, F_SETFL, O_NONBLOCK);
+
+        client *c = NULL;
+        for (int i = 0; i < MAX_CLIENTS && !c; ++i) {
+            if (clients[i].fd < 0) {
+                c = &clients[i];
+            }
+        }
+
+        if (!c) {
+            const char *message = "error too many clients\n";
+            send(client_fd, message, strlen(message), MSG_NOSIGNAL | MSG_DONTWAIT);
+            close(client_fd);
+            continue;
+        }
+
+        c->fd = client_fd;
+        c->length = 0;
+        c->is_discarding = false;
+        if (!bb_main_loop_add_fd(client_fd, client_cb, c)) {
+            close(client_fd);
+            c->fd = -1;
+        }
+    }
+}
+
+static void client_cb(int fd, void *user_data) {
+    client *c = user_data;
+
+    while (c->length < BUFFER_SIZE) {
+        ssize_t n = read(fd, c->buffer + c->length, BUFFER_SIZE - c->length);
+        if (n > 0) {
+            c->length += n;
+            continue;
+        }
+        if (n == 0 || (errno != EAGAIN && errno != EINTR)) {
+            close_client(c);
+            return;
+        }
+        if (errno == EAGAIN) {
+            break;
+        }
+    }
+
+    /* Run all complete lines and keep the rest for the next read */
+    size_t start = 0;
+    char *newline;
+    while ((newline = memchr(c->buffer + start, '\n', c->length - start)) != NULL) {
+        *newline = '\0';
+        size_t line_start = start;
+        start = newline - c->buffer + 1;
+
+        if (c->is_discarding) {
+            c->is_discarding = false;
+            continue;
+        }
+        if (!run_command(c, c->buffer + line_start)) {
+            return;
+        }
+    }
+
+    /* Drop lines that don't fit into the buffer but keep the client connected */
+    if (start == 0 && c->length == BUFFER_SIZE) {
+        if (!c->is_discarding) {
+            const char *message = "error command too long\n";
+            if (!send_line(c, message, strlen(message))) {
+                return;
+            }
+            c->is_discarding = true;
+        }
+        c->length = 0;
+        return;
+    }
+
+    memmove(c->buffer, c->buffer + start, c->length - start);
+    c->length -= start;
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_control_init(const char *path, bb_control_cb cb) {
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Control socket path %s is too long", path);
+        return false;
+    }
+    strcpy(addr.sun_path, path);
+
+    /* A socket left behind by an instance that didn't shut down cleanly can be replaced, a live one can't */
+    if (is_in_use(&addr)) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Control socket %s is in use by another process", path);
+        return false;
+    }
+    unlink(path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not create control socket: %s", strerror(errno));
+        return false;
+    }
+
+    /* Commands can change what the keyboard types, so only the owner may connect */
+    mode_t old_umask = umask(0177);
+    bool is_bound = bind(listen_fd, (const struct sockaddr *)&addr, sizeof(addr)) == 0;
+    umask(old_umask);
+
+    if (!is_bound || listen(listen_fd, MAX_CLIENTS) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not listen on control socket %s: %s", path, strerror(errno));
+        close(listen_fd);
+        listen_fd = -1;
+        return false;
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        clients[i].fd = -1;
+    }
+    callback = cb;
+    strcpy(socket_path, path);
+
+    if (!bb_main_loop_add_fd(listen_fd, accept_cb, NULL)) {
+        bb_control_stop();
+        return false;
+    }
+
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Listening for commands on %s", path);
+    return true;
+}
+
+void bb_control_stop(void) {
+    if (listen_fd < 0) {
+        return;
+    }
+
+    for (int i = 0; i < MAX_CLIENTS; ++i) {
+        if (clients[i].fd >= 0) {
+            close_client(&clients[i]);
+        }
+    }
+
+    bb_main_loop_remove_fd(listen_fd);
+    close(listen_fd);
+    listen_fd = -1;
+    unlink(socket_path);
+}
@@ -0,0 +1,42 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_CONTROL_H
+#define BB_CONTROL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Path of the control socket unless configured otherwise */
+#define BB_CONTROL_DEFAULT_PATH "/run/buffyboard.sock"
+
+/**
+ * Callback for commands received on the control socket.
+ *
+ * @param command name of the command
+ * @param arg remainder of the line after the command name, empty if there is none
+ * @param reply buffer for writing a single-line reply or error message into, empty by default
+ * @param reply_size size of the reply buffer
+ * @return true if the command succeeded, false otherwise
+ */
+typedef bool (*bb_control_cb)(const char *command, const char *arg, char *reply, size_t reply_size);
+
+/**
+ * Listen for commands on a UNIX domain socket. Clients send one command per line and receive one line
+ * starting with "ok" or "error" per command. Requires the main loop to be initialised.
+ *
+ * @param path path of the socket
+ * @param cb callback to invoke from the main loop for each received command
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_control_init(const char *path, bb_control_cb cb);
+
+/**
+ * Disconnect all clients and remove the socket.
+ */
+void bb_control_stop(void);
+
+#endif /* BB_CONTROL_H */
@@ -0,0 +1,157 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "diagnostics.h"
+
+#include "../shared/log.h"
+
+
+/**
+ * Defines
+ */
+
+/* Maximum number of distinct widget types to count */
+#define MAX_CLASSES 32
+
+
+/**
+ * Static types
+ */
+
+/* Number of objects of a widget type */
+typedef struct {
+    /* Widget class */
+    const lv_obj_class_t *cls;
+    /* Number of objects */
+    uint32_t count;
+} class_count;
+
+/* Widget class with a human-readable name */
+typedef struct {
+    /* Widget class */
+    const lv_obj_class_t *cls;
+    /* Name of the class */
+    const char *name;
+} class_name;
+
+
+/**
+ * Static variables
+ */
+
+/* Names of the widget types that buffyboard creates */
+static const class_name known_classes[] = {
+    { &lv_obj_class, "obj" },
+    { &lv_keyboard_class, "keyboard" },
+    { &lv_buttonmatrix_class, "buttonmatrix" },
+    { &lv_label_class, "label" }
+};
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Count an object and all of its descendants by widget type.
+ *
+ * @param obj root object
+ * @param counts array of counts to update
+ * @param num_counts pointer to the number of used entries in counts
+ * @return total number of objects in the tree
+ */
+static uint32_t count_objects(const lv_obj_t *obj, class_count *counts, int *num_counts);
+
+/**
+ * Look up the name of a widget class.
+ *
+ * @param cls widget class
+ * @return name or NULL if the class is unknown
+ */
+static const char *get_class_name(const lv_obj_class_t *cls);
+
+
+/**
+ * Static functions
+ */
+
+static uint32_t count_objects(const lv_obj_t *obj, class_count *counts, int *num_counts) {
+    if (!obj) {
+        return 0;
+    }
+
+    const lv_obj_class_t *cls = lv_obj_get_class(obj);
+    int i = 0;
+    while (i < *num_counts && counts[i].cls != cls) {
+        ++i;
+    }
+    if (i < MAX_CLASSES) {
+        if (i == *num_counts) {
+            counts[i].cls = cls;
+            counts[i].count = 0;
+            ++(*num_counts);
+        }
+        counts[i].count++;
+    }
+
+    uint32_t total = 1;
+    uint32_t num_children = lv_obj_get_child_count(obj);
+    for (uint32_t j = 0; j < num_children; ++j) {
+        total += count_objects(lv_obj_get_child(obj, j), counts, num_counts);
+    }
+    return total;
+}
+
+static const char *get_class_name(const lv_obj_class_t *cls) {
+    for (size_t i = 0; i < sizeof(known_classes) / sizeof(known_classes[0]); ++i) {
+        if (known_classes[i].cls == cls) {
+            return known_classes[i].name;
+        }
+    }
+    return NULL;
+}
+
+
+/**
+ * Public functions
+ */
+
+void bb_diagnostics_dump(lv_display_t *disp) {
+    /* The dump was explicitly requested, so log it regardless of the verbosity */
+    class_count counts[MAX_CLASSES];
+    int num_counts = 0;
+    uint32_t total = count_objects(lv_display_get_screen_active(disp), counts, &num_counts)
+        + count_objects(lv_display_get_layer_bottom(disp), counts, &num_counts)
+        + count_objects(lv_display_get_layer_top(disp), counts, &num_counts)
+        + count_objects(lv_display_get_layer_sys(disp), counts, &num_counts);
+
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Objects: %u", total);
+    for (int i = 0; i < num_counts; ++i) {
+        const char *name = get_class_name(counts[i].cls);
+        if (name) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "  %s: %u", name, counts[i].count);
+        } else {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "  class %p: %u", (const void *)counts[i].cls, counts[i].count);
+        }
+    }
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    if (mem.total_size > 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Memory: %zu/%zu bytes used (%u%%), %zu bytes max, %u%% fragmentation",
+            mem.total_size - mem.free_size, mem.total_size, mem.used_pct, mem.max_used, mem.frag_pct);
+        bbx_log(BBX_LOG_LEVEL_ERROR, "  %zu used and %zu free blocks, biggest free block %zu bytes",
+            mem.used_cnt, mem.free_cnt, mem.free_biggest_size);
+    } else {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Memory: statistics not available with the system allocator");
+    }
+
+    lv_draw_buf_t *draw_buf = lv_display_get_buf_active(disp);
+    if (draw_buf) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Draw buffer: %u bytes (%ux%u px)", draw_buf->data_size,
+            draw_buf->header.w, draw_buf->header.h);
+    }
+}
@@ -0,0 +1,19 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_DIAGNOSTICS_H
+#define BB_DIAGNOSTICS_H
+
+#include "lvgl/lvgl.h"
+
+/**
+ * Log the number of LVGL objects per widget type, allocator statistics and draw buffer sizes of a display.
+ *
+ * @param disp display to inspect
+ */
+void bb_diagnostics_dump(lv_display_t *disp);
+
+#endif /* BB_DIAGNOSTICS_H */
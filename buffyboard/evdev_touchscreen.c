@@ -0,0 +1,469 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "evdev_touchscreen.h"
+
+#include "main_loop.h"
+
+#include "../shared/log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+#include <sys/ioctl.h>
+
+
+/**
+ * Defines
+ */
+
+/* Number of multi-touch slots to track. Contacts in higher slots are ignored. */
+#define MAX_SLOTS 10
+
+/* Capacity of the queue of pointer states waiting to be read by LVGL */
+#define MAX_QUEUED_STATES 32
+
+/* Number of input events to read from the device at once */
+#define READ_BATCH_SIZE 64
+
+/* Helpers for testing bits in arrays filled by EVIOCGBIT and EVIOCGPROP */
+#define NUM_LONGS(bits) (((bits) + 8 * sizeof(long) - 1) / (8 * sizeof(long)))
+#define TEST_BIT(bit, array) ((array[(bit) / (8 * sizeof(long))] >> ((bit) % (8 * sizeof(long)))) & 1)
+
+
+/**
+ * Static types
+ */
+
+/* Multi-touch slot */
+typedef struct {
+    /* Tracking ID of the contact or -1 if the slot is unused */
+    int tracking_id;
+    /* Raw horizontal position */
+    int x;
+    /* Raw vertical position */
+    int y;
+} touch_slot;
+
+/* Pointer state as reported to LVGL */
+typedef struct {
+    /* Position in display coordinates */
+    lv_point_t point;
+    /* Pressed or released */
+    lv_indev_state_t state;
+} pointer_state;
+
+
+/**
+ * Static variables
+ */
+
+static int fd = -1;
+static lv_indev_t *indev = NULL;
+static lv_area_t display_area;
+static int32_t physical_width = 0;
+static int32_t physical_height = 0;
+
+static bool is_multitouch = false;
+static struct input_absinfo abs_x;
+static struct input_absinfo abs_y;
+
+static touch_slot slots[MAX_SLOTS];
+static int current_slot = 0;
+static int primary_slot = -1;
+static bool dropped = false;
+
+/* Single-touch state for devices without multi-touch support */
+static touch_slot single;
+static bool single_touching = false;
+
+static pointer_state queue[MAX_QUEUED_STATES];
+static int queue_start = 0;
+static int queue_length = 0;
+static pointer_state last_state;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Test if an evdev node is a touchscreen and, if so, keep it open.
+ *
+ * @param path path of the evdev node
+ * @return true if the node is a touchscreen, false otherwise
+ */
+static bool probe_device(const char *path);
+
+/**
+ * Map a raw contact position to display coordinates.
+ *
+ * @param x raw horizontal position
+ * @param y raw vertical position
+ * @return point in display coordinates
+ */
+static lv_point_t map_position(int x, int y);
+
+/**
+ * Append a pointer state to the queue, merging it with the previous one if possible.
+ *
+ * @param state pressed or released
+ * @param point position in display coordinates
+ */
+static void push_state(lv_indev_state_t state, lv_point_t point);
+
+/**
+ * Handle the end of an event frame (SYN_REPORT) by translating the current contacts into a pointer state.
+ */
+static void handle_frame(void);
+
+/**
+ * Handle a single input event.
+ *
+ * @param event the event
+ */
+static void handle_event(const struct input_event *event);
+
+/**
+ * Callback for when the device has become readable.
+ *
+ * @param device_fd the device's file descriptor
+ * @param user_data unused
+ */
+static void device_readable_cb(int device_fd, void *user_data);
+
+/**
+ * LVGL read callback for the input device.
+ *
+ * @param device the input device
+ * @param data pointer for writing the current state into
+ */
+static void read_cb(lv_indev_t *device, lv_indev_data_t *data);
+
+
+/**
+ * Static functions
+ */
+
+static bool probe_device(const char *path) {
+    int device_fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (device_fd < 0) {
+        return false;
+    }
+
+    unsigned long props[NUM_LONGS(INPUT_PROP_CNT)] = { 0 };
+    unsigned long abs_bits[NUM_LONGS(ABS_CNT)] = { 0 };
+    unsigned long key_bits[NUM_LONGS(KEY_CNT)] = { 0 };
+
+    if (ioctl(device_fd, EVIOCGPROP(sizeof(props)), props) < 0
+            || ioctl(device_fd, EVIOCGBIT(EV_ABS, sizeof(abs_bits)), abs_bits) < 0
+            || ioctl(device_fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) < 0) {
+        close(device_fd);
+        return false;
+    }
+
+    /* Touchpads report absolute positions as well but are indirect devices */
+    if (!TEST_BIT(INPUT_PROP_DIRECT, props)) {
+        close(device_fd);
+        return false;
+    }
+
+    bool multitouch = TEST_BIT(ABS_MT_SLOT, abs_bits)
+        && TEST_BIT(ABS_MT_POSITION_X, abs_bits) && TEST_BIT(ABS_MT_POSITION_Y, abs_bits);
+    bool singletouch = TEST_BIT(ABS_X, abs_bits) && TEST_BIT(ABS_Y, abs_bits) && TEST_BIT(BTN_TOUCH, key_bits);
+
+    if (!multitouch && !singletouch) {
+        close(device_fd);
+        return false;
+    }
+
+    if (ioctl(device_fd, EVIOCGABS(multitouch ? ABS_MT_POSITION_X : ABS_X), &abs_x) < 0
+            || ioctl(device_fd, EVIOCGABS(multitouch ? ABS_MT_POSITION_Y : ABS_Y), &abs_y) < 0
+            || abs_x.maximum <= abs_x.minimum || abs_y.maximum <= abs_y.minimum) {
+        close(device_fd);
+        return false;
+    }
+
+    fd = device_fd;
+    is_multitouch = multitouch;
+    return true;
+}
+
+static lv_point_t map_position(int x, int y) {
+    /* Scale to physical framebuffer coordinates. The touch panel is assumed to be aligned with the framebuffer
+     * (i.e. no calibration matrix). */
+    int64_t px = (int64_t)(x - abs_x.minimum) * physical_width / (abs_x.maximum - abs_x.minimum + 1);
+    int64_t py = (int64_t)(y - abs_y.minimum) * physical_height / (abs_y.maximum - abs_y.minimum + 1);
+
+    /* Make relative to the display. LVGL expects unrotated coordinates and applies the rotation itself. */
+    lv_point_t point;
+    point.x = LV_MIN(LV_MAX(px - display_area.x1, 0), display_area.x2 - display_area.x1);
+    point.y = LV_MIN(LV_MAX(py - display_area.y1, 0), display_area.y2 - display_area.y1);
+    return point;
+}
+
+static void push_state(lv_indev_state_t state, lv_point_t point) {
+    pointer_state *last = (queue_length > 0) ? &queue[(queue_start + queue_length - 1) % MAX_QUEUED_STATES] : &last_state;
+    pointer_state *before_last = (queue_length > 1) ? &queue[(queue_start + queue_length - 2) % MAX_QUEUED_STATES] : &last_state;
+
+    /* Drop repeated releases */
+    if (state == LV_INDEV_STATE_RELEASED && last->state == LV_INDEV_STATE_RELEASED) {
+        return;
+    }
+
+    /* Collapse consecutive moves of a pressed contact but keep the position of the initial press intact */
+    if (queue_length > 0 && state == LV_INDEV_STATE_PRESSED
+            && last->state == LV_INDEV_STATE_PRESSED && before_last->state == LV_INDEV_STATE_PRESSED) {
+        last->point = point;
+        return;
+    }
+
+    if (queue_length == MAX_QUEUED_STATES) {
+        /* Drop the oldest state rather than the newest to keep the final position accurate */
+        queue_start = (queue_start + 1) % MAX_QUEUED_STATES;
+        queue_length--;
+    }
+
+    pointer_state *next = &queue[(queue_start + queue_length) % MAX_QUEUED_STATES];
+    next->state = state;
+    next->point = point;
+    queue_length++;
+}
+
+static void handle_frame(void) {
+    if (!is_multitouch) {
+        push_state(single_touching ? LV_INDEV_STATE_PRESSED : LV_INDEV_STATE_RELEASED, map_position(single.x, single.y));
+        return;
+    }
+
+    /* LVGL pointers track a single contact. Follow the first contact until it's lifted, then report a release
+     * before picking up the next remaining contact as a new press. */
+    if (primary_slot >= 0) {
+        touch_slot *primary = &slots[primary_slot];
+        if (primary->tracking_id >= 0) {
+            push_state(LV_INDEV_STATE_PRESSED, map_position(primary->x, primary->y));
+            return;
+        }
+        push_state(LV_INDEV_STATE_RELEASED, map_position(primary->x, primary->y));
+        primary_slot = -1;
+    }
+
+    for (int i = 0; i < MAX_SLOTS; ++i) {
+        if (slots[i].tracking_id >= 0) {
+            primary_slot = i;
+            push_state(LV_INDEV_STATE_PRESSED, map_position(slots[i].x, slots[i].y));
+            return;
+        }
+    }
+}
+
+static void handle_event(const struct input_event *event) {
+    if (event->type == EV_SYN) {
+        if (event->code == SYN_DROPPED) {
+            /* The kernel buffer overflowed. Discard everything up to the next report and start over. */
+            dropped = true;
+        } else if (event->code == SYN_REPORT) {
+            if (dropped) {
+                dropped = false;
+                for (int i = 0; i < MAX_SLOTS; ++i) {
+                    slots[i].tracking_id = -1;
+                }
+                single_touching = false;
+            }
+            handle_frame();
+        }
+        return;
+    }
+
+    if (dropped) {
+        return;
+    }
+
+    if (event->type == EV_KEY && event->code == BTN_TOUCH && !is_multitouch) {
+        single_touching = (event->value != 0);
+        return;
+    }
+
+    if (event->type != EV_ABS) {
+        return;
+    }
+
+    if (!is_multitouch) {
+        if (event->code == ABS_X) {
+            single.x = event->value;
+        } else if (event->code == ABS_Y) {
+            single.y = event->value;
+        }
+        return;
+    }
+
+    if (event->code == ABS_MT_SLOT) {
+        current_slot = event->value;
+        return;
+    }
+
+    if (current_slot < 0 || current_slot >= MAX_SLOTS) {
+        return;
+    }
+
+    switch (event->code) {
+        case ABS_MT_TRACKING_ID:
+            slots[current_slot].tracking_id = event->value;
+            break;
+        case ABS_MT_POSITION_X:
+            slots[current_slot].x = event->value;
+            break;
+        case ABS_MT_POSITION_Y:
+            slots[current_slot].y = event->value;
+            break;
+        default:
+            break;
+    }
+}
+
+static void device_readable_cb(int device_fd, void *user_data) {
+    LV_UNUSED(user_data);
+
+    struct input_event events[READ_BATCH_SIZE];
+
+    while (1) {
+        ssize_t num_bytes = read(device_fd, events, sizeof(events));
+        if (num_bytes < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno != EAGAIN) {
+                bbx_log(BBX_LOG_LEVEL_ERROR, "Could not read from touchscreen, disconnecting: %s", strerror(errno));
+                bb_main_loop_remove_fd(device_fd);
+                close(device_fd);
+                fd = -1;
+                push_state(LV_INDEV_STATE_RELEASED, last_state.point);
+            }
+            break;
+        }
+
+        for (size_t i = 0; i < (size_t)num_bytes / sizeof(struct input_event); ++i) {
+            handle_event(&events[i]);
+        }
+
+        if ((size_t)num_bytes < sizeof(events)) {
+            break;
+        }
+    }
+
+    if (queue_length > 0) {
+        lv_indev_read(indev);
+    }
+}
+
+static void read_cb(lv_indev_t *device, lv_indev_data_t *data) {
+    LV_UNUSED(device);
+
+    if (queue_length > 0) {
+        last_state = queue[queue_start];
+        queue_start = (queue_start + 1) % MAX_QUEUED_STATES;
+        queue_length--;
+    }
+
+    data->point = last_state.point;
+    data->state = last_state.state;
+    data->continue_reading = (queue_length > 0);
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_evdev_touchscreen_init(lv_display_t *disp, const lv_area_t *area) {
+    DIR *dir = opendir("/dev/input");
+    if (!dir) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not open /dev/input: %s", strerror(errno));
+        return false;
+    }
+
+    char path[PATH_MAX];
+    struct dirent *entry;
+    while (fd < 0 && (entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "event", 5) != 0) {
+            continue;
+        }
+        snprintf(path, sizeof(path), "/dev/input/%s", entry->d_name);
+        probe_device(path);
+    }
+    closedir(dir);
+
+    if (fd < 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not find a touchscreen in /dev/input");
+        return false;
+    }
+
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Connecting %s touchscreen %s",
+        is_multitouch ? "multi-touch" : "single-touch", path);
+
+    display_area = *area;
+    physical_width = lv_display_get_physical_horizontal_resolution(disp);
+    physical_height = lv_display_get_physical_vertical_resolution(disp);
+
+    for (int i = 0; i < MAX_SLOTS; ++i) {
+        slots[i].tracking_id = -1;
+    }
+    if (is_multitouch) {
+        struct input_absinfo abs_slot;
+        if (ioctl(fd, EVIOCGABS(ABS_MT_SLOT), &abs_slot) == 0) {
+            current_slot = abs_slot.value;
+        }
+    }
+    last_state.state = LV_INDEV_STATE_RELEASED;
+    last_state.point.x = 0;
+    last_state.point.y = 0;
+
+    /* No driver data is set on purpose so that the main loop doesn't mistake this for a libinput device */
+    indev = lv_indev_create();
+    lv_indev_set_type(indev, LV_INDEV_TYPE_POINTER);
+    lv_indev_set_read_cb(indev, read_cb);
+    lv_indev_set_display(indev, disp);
+
+    if (!bb_main_loop_add_fd(fd, device_readable_cb, NULL)) {
+        lv_indev_delete(indev);
+        indev = NULL;
+        close(fd);
+        fd = -1;
+        return false;
+    }
+
+    return true;
+}
+
+void bb_evdev_touchscreen_stop(void) {
+    if (fd >= 0) {
+        bb_main_loop_remove_fd(fd);
+        close(fd);
+        fd = -1;
+    }
+
+    if (indev) {
+        lv_indev_delete(indev);
+        indev = NULL;
+    }
+
+    /* Start from a clean slate when connecting again */
+    is_multitouch = false;
+    current_slot = 0;
+    primary_slot = -1;
+    dropped = false;
+    single_touching = false;
+    queue_start = 0;
+    queue_length = 0;
+}
@@ -0,0 +1,29 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_EVDEV_TOUCHSCREEN_H
+#define BB_EVDEV_TOUCHSCREEN_H
+
+#include "lvgl/lvgl.h"
+
+#include <stdbool.h>
+
+/**
+ * Find the first touchscreen in /dev/input, open it and connect it to a display. The device is read
+ * directly from its evdev node without going through libinput. Requires the main loop to be initialised.
+ *
+ * @param disp display to connect the touchscreen to
+ * @param area area covered by the display in physical (unrotated) framebuffer coordinates
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_evdev_touchscreen_init(lv_display_t *disp, const lv_area_t *area);
+
+/**
+ * Disconnect the touchscreen and close its evdev node. Does nothing if no touchscreen is connected.
+ */
+void bb_evdev_touchscreen_stop(void);
+
+#endif /* BB_EVDEV_TOUCHSCREEN_H */
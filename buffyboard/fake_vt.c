@@ -0,0 +1,281 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "fake_vt.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <linux/kd.h>
+#include <linux/vt.h>
+
+
+/**
+ * Defines
+ */
+
+/* Maximum number of simultaneously open file descriptors */
+#define MAX_FDS 64
+
+/* First file descriptor handed out, chosen so as not to clash with real ones in log output */
+#define FD_BASE 1000
+
+
+/**
+ * Static types
+ */
+
+/* Fake VT */
+typedef struct {
+    /* Whether the VT is allocated */
+    bool is_allocated;
+    /* Current size */
+    struct winsize size;
+} fake_vt;
+
+
+/**
+ * Static variables
+ */
+
+static fake_vt vts[MAX_NR_CONSOLES];
+static int fd_vts[MAX_FDS];
+static int active_vt = 1;
+static int screen_width = 0;
+static int screen_height = 0;
+static int cell_width = 1;
+static int cell_height = 1;
+static bool can_query_font = true;
+static bb_fake_vt_counters counters;
+
+/* Guards all of the above against concurrent access from the eager resize worker */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Open a fake VT device.
+ *
+ * @param path /dev/tty0 for the active VT or /dev/ttyN for VT N
+ * @param flags ignored
+ * @return file descriptor or -1 on failure
+ */
+static int fake_open(const char *path, int flags);
+
+/**
+ * Close a fake VT device.
+ *
+ * @param fd file descriptor
+ * @return 0 on success, -1 on failure
+ */
+static int fake_close(int fd);
+
+/**
+ * Perform an ioctl on a fake VT device.
+ *
+ * @param fd file descriptor
+ * @param request one of VT_GETSTATE, TIOCGWINSZ, TIOCSWINSZ and KDFONTOP
+ * @param arg request argument
+ * @return 0 on success, -1 on failure
+ */
+static int fake_ioctl(int fd, unsigned long request, void *arg);
+
+/**
+ * Look up the VT that a file descriptor refers to. Must be called with the lock held.
+ *
+ * @param fd file descriptor
+ * @return pointer to the VT or NULL if the file descriptor is invalid
+ */
+static fake_vt *get_vt(int fd);
+
+
+/**
+ * Public variables
+ */
+
+const bb_terminal_ops bb_fake_vt_ops = { fake_open, fake_close, fake_ioctl };
+
+
+/**
+ * Static functions
+ */
+
+static int fake_open(const char *path, int flags) {
+    int vt = 0;
+    if (sscanf(path, "/dev/tty%d", &vt) != 1 || vt < 0 || vt > MAX_NR_CONSOLES) {
+        errno = ENOENT;
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+
+    /* /dev/tty0 is bound to whichever VT is active at the time it's opened */
+    if (vt == 0) {
+        vt = active_vt;
+    }
+
+    int fd = -1;
+    for (int i = 0; i < MAX_FDS; ++i) {
+        if (fd_vts[i] == 0) {
+            fd_vts[i] = vt;
+            fd = FD_BASE + i;
+            break;
+        }
+    }
+
+    if (fd < 0) {
+        errno = EMFILE;
+    } else {
+        /* Opening a VT allocates it */
+        vts[vt - 1].is_allocated = true;
+        counters.opens++;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return fd;
+}
+
+static int fake_close(int fd) {
+    pthread_mutex_lock(&lock);
+
+    int result = 0;
+    if (fd < FD_BASE || fd >= FD_BASE + MAX_FDS || fd_vts[fd - FD_BASE] == 0) {
+        errno = EBADF;
+        result = -1;
+    } else {
+        fd_vts[fd - FD_BASE] = 0;
+    }
+
+    pthread_mutex_unlock(&lock);
+    return result;
+}
+
+static int fake_ioctl(int fd, unsigned long request, void *arg) {
+    pthread_mutex_lock(&lock);
+    counters.ioctls++;
+
+    int result = 0;
+    fake_vt *vt = get_vt(fd);
+    if (!vt) {
+        errno = EBADF;
+        result = -1;
+        goto out;
+    }
+
+    switch (request) {
+        case VT_GETSTATE: {
+            struct vt_stat *stat = arg;
+            stat->v_active = active_vt;
+            stat->v_signal = 0;
+            stat->v_state = 0;
+            for (int i = 0; i < MAX_NR_CONSOLES && i < 15; ++i) {
+                if (vts[i].is_allocated) {
+                    stat->v_state |= 1 << (i + 1);
+                }
+            }
+            break;
+        }
+        case TIOCGWINSZ:
+            *(struct winsize *)arg = vt->size;
+            break;
+        case TIOCSWINSZ: {
+            /* Like fbcon, reject sizes that don't fit onto the screen */
+            struct winsize *size = arg;
+            if (size->ws_row == 0 || size->ws_col == 0 || size->ws_row * cell_height > screen_height
+                    || size->ws_col * cell_width > screen_width) {
+                errno = EINVAL;
+                result = -1;
+                break;
+            }
+
+            /* The kernel only notifies the foreground process group if the size actually changed */
+            if (size->ws_row != vt->size.ws_row || size->ws_col != vt->size.ws_col) {
+                counters.sigwinch++;
+            }
+            vt->size = *size;
+            break;
+        }
+        case KDFONTOP: {
+            if (!can_query_font) {
+                errno = ENOSYS;
+                result = -1;
+                break;
+            }
+            struct console_font_op *op = arg;
+            op->width = cell_width;
+            op->height = cell_height;
+            break;
+        }
+        default:
+            errno = ENOTTY;
+            result = -1;
+            break;
+    }
+
+out:
+    pthread_mutex_unlock(&lock);
+    return result;
+}
+
+static fake_vt *get_vt(int fd) {
+    if (fd < FD_BASE || fd >= FD_BASE + MAX_FDS || fd_vts[fd - FD_BASE] == 0) {
+        return NULL;
+    }
+    return &vts[fd_vts[fd - FD_BASE] - 1];
+}
+
+
+/**
+ * Public functions
+ */
+
+void bb_fake_vt_init(int width, int height, int font_width, int font_height, bool has_font_op, int num_vts) {
+    pthread_mutex_lock(&lock);
+
+    screen_width = width;
+    screen_height = height;
+    cell_width = font_width;
+    cell_height = font_height;
+    can_query_font = has_font_op;
+    active_vt = 1;
+
+    for (int i = 0; i < MAX_NR_CONSOLES; ++i) {
+        vts[i].is_allocated = (i < num_vts);
+        vts[i].size.ws_row = height / font_height;
+        vts[i].size.ws_col = width / font_width;
+        vts[i].size.ws_xpixel = 0;
+        vts[i].size.ws_ypixel = 0;
+    }
+
+    memset(&counters, 0, sizeof(counters));
+
+    pthread_mutex_unlock(&lock);
+}
+
+void bb_fake_vt_set_active(int vt) {
+    pthread_mutex_lock(&lock);
+    active_vt = vt;
+    vts[vt - 1].is_allocated = true;
+    pthread_mutex_unlock(&lock);
+}
+
+void bb_fake_vt_get_size(int vt, struct winsize *size) {
+    pthread_mutex_lock(&lock);
+    *size = vts[vt - 1].size;
+    pthread_mutex_unlock(&lock);
+}
+
+void bb_fake_vt_take_counters(bb_fake_vt_counters *c) {
+    pthread_mutex_lock(&lock);
+    *c = counters;
+    memset(&counters, 0, sizeof(counters));
+    pthread_mutex_unlock(&lock);
+}
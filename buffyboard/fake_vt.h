@@ -0,0 +1,66 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_FAKE_VT_H
+#define BB_FAKE_VT_H
+
+#include "terminal.h"
+
+#include <stdbool.h>
+
+#include <sys/ioctl.h>
+
+/**
+ * Counters of operations performed on fake VTs
+ */
+typedef struct {
+    /* Number of opened file descriptors */
+    long opens;
+    /* Number of ioctls */
+    long ioctls;
+    /* Number of SIGWINCH signals that the kernel would have delivered */
+    long sigwinch;
+} bb_fake_vt_counters;
+
+/* Operations for passing to bb_terminal_set_ops that act on the fake VTs */
+extern const bb_terminal_ops bb_fake_vt_ops;
+
+/**
+ * Set up in-memory fake VTs that behave like framebuffer consoles. Each VT starts out with as many rows and
+ * columns as fit onto the screen. VT 1 is active. All counters are reset.
+ *
+ * @param width horizontal resolution of the console in pixels
+ * @param height vertical resolution of the console in pixels
+ * @param font_width width of the console font in pixels
+ * @param font_height height of the console font in pixels
+ * @param has_font_op true if the font can be queried with KDFONTOP, false if it has to be probed for
+ * @param num_vts number of allocated VTs
+ */
+void bb_fake_vt_init(int width, int height, int font_width, int font_height, bool has_font_op, int num_vts);
+
+/**
+ * Switch to another VT.
+ *
+ * @param vt number of the VT (e.g. 7 for /dev/tty7)
+ */
+void bb_fake_vt_set_active(int vt);
+
+/**
+ * Get the current size of a VT.
+ *
+ * @param vt number of the VT (e.g. 7 for /dev/tty7)
+ * @param size pointer for writing the size into
+ */
+void bb_fake_vt_get_size(int vt, struct winsize *size);
+
+/**
+ * Get the counters and reset them.
+ *
+ * @param counters pointer for writing the counters into
+ */
+void bb_fake_vt_take_counters(bb_fake_vt_counters *counters);
+
+#endif /* BB_FAKE_VT_H */
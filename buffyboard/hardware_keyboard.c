@@ -0,0 +1,228 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "hardware_keyboard.h"
+
+#include "main_loop.h"
+#include "uinput_device.h"
+
+#include "../shared/log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+
+
+/**
+ * Defines
+ */
+
+/* Helpers for testing bits in arrays filled by EVIOCGBIT */
+#define NUM_LONGS(bits) (((bits) + 8 * sizeof(long) - 1) / (8 * sizeof(long)))
+#define TEST_BIT(bit, array) ((array[(bit) / (8 * sizeof(long))] >> ((bit) % (8 * sizeof(long)))) & 1)
+
+
+/**
+ * Static variables
+ */
+
+static int inotify_fd = -1;
+static bb_hardware_keyboard_cb callback = NULL;
+static bool is_connected = false;
+static char own_sysname[64] = "";
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Test if an evdev node belongs to buffyboard's own uinput device.
+ *
+ * @param name file name of the evdev node in /dev/input
+ * @return true if the node belongs to the uinput device, false otherwise
+ */
+static bool is_own_device(const char *name);
+
+/**
+ * Test if an evdev node is a hardware keyboard.
+ *
+ * @param name file name of the evdev node in /dev/input
+ * @return true if the node is a keyboard, false otherwise
+ */
+static bool is_keyboard(const char *name);
+
+/**
+ * Scan /dev/input for hardware keyboards and invoke the callback if their presence changed.
+ */
+static void scan_devices(void);
+
+/**
+ * Handle changes in /dev/input.
+ *
+ * @param fd inotify file descriptor
+ * @param user_data unused
+ */
+static void inotify_cb(int fd, void *user_data);
+
+
+/**
+ * Static functions
+ */
+
+static bool is_own_device(const char *name) {
+    if (own_sysname[0] == '\0') {
+        return false;
+    }
+
+    /* /sys/class/input/eventN/device links to the parent input device, e.g. ../../input12 */
+    char path[PATH_MAX];
+    char target[PATH_MAX];
+    snprintf(path, sizeof(path), "/sys/class/input/%s/device", name);
+    ssize_t length = readlink(path, target, sizeof(target) - 1);
+    if (length < 0) {
+        return false;
+    }
+    target[length] = '\0';
+
+    const char *base = strrchr(target, '/');
+    return strcmp(base ? base + 1 : target, own_sysname) == 0;
+}
+
+static bool is_keyboard(const char *name) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "/dev/input/%s", name);
+
+    int device_fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (device_fd < 0) {
+        return false;
+    }
+
+    unsigned long key_bits[NUM_LONGS(KEY_CNT)] = { 0 };
+    bool result = ioctl(device_fd, EVIOCGBIT(EV_KEY, sizeof(key_bits)), key_bits) >= 0;
+    close(device_fd);
+
+    /* Power buttons, headset jacks and remote controls also emit EV_KEY. Only count devices that can type. */
+    const int required_keys[] = { KEY_Q, KEY_A, KEY_Z, KEY_SPACE, KEY_ENTER };
+    for (size_t i = 0; result && i < sizeof(required_keys) / sizeof(required_keys[0]); ++i) {
+        result = TEST_BIT(required_keys[i], key_bits);
+    }
+
+    return result;
+}
+
+static void scan_devices(void) {
+    DIR *dir = opendir("/dev/input");
+    if (!dir) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not open /dev/input: %s", strerror(errno));
+        return;
+    }
+
+    bool found = false;
+    struct dirent *entry;
+    while (!found && (entry = readdir(dir)) != NULL) {
+        if (strncmp(entry->d_name, "event", 5) != 0 || is_own_device(entry->d_name)) {
+            continue;
+        }
+        if (is_keyboard(entry->d_name)) {
+            bbx_log(BBX_LOG_LEVEL_VERBOSE, "Found hardware keyboard /dev/input/%s", entry->d_name);
+            found = true;
+        }
+    }
+    closedir(dir);
+
+    if (found != is_connected) {
+        is_connected = found;
+        callback(found);
+    }
+}
+
+static void inotify_cb(int fd, void *user_data) {
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool rescan = false;
+
+    ssize_t length;
+    while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+        for (char *ptr = buffer; ptr < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+            if (event->len > 0 && strncmp(event->name, "event", 5) == 0) {
+                rescan = true;
+            }
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    /* Rescanning all nodes is cheap and avoids tracking which node belonged to which keyboard */
+    if (rescan) {
+        scan_devices();
+    }
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_hardware_keyboard_monitor_init(bb_hardware_keyboard_cb cb) {
+    if (inotify_fd >= 0) {
+        return true;
+    }
+
+    callback = cb;
+
+    if (!bb_uinput_device_get_sysname(own_sysname, sizeof(own_sysname))) {
+        /* Without the name we'd detect ourselves as a hardware keyboard and never show up */
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not identify own uinput device, not watching for hardware keyboards");
+        return false;
+    }
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not create inotify instance: %s", strerror(errno));
+        return false;
+    }
+
+    /* New nodes may not be accessible until udev has applied permissions, so watch for attribute changes, too */
+    if (inotify_add_watch(inotify_fd, "/dev/input", IN_CREATE | IN_DELETE | IN_ATTRIB) < 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not watch /dev/input: %s", strerror(errno));
+        close(inotify_fd);
+        inotify_fd = -1;
+        return false;
+    }
+
+    if (!bb_main_loop_add_fd(inotify_fd, inotify_cb, NULL)) {
+        close(inotify_fd);
+        inotify_fd = -1;
+        return false;
+    }
+
+    scan_devices();
+    return true;
+}
+
+void bb_hardware_keyboard_monitor_stop(void) {
+    if (inotify_fd < 0) {
+        return;
+    }
+
+    bb_main_loop_remove_fd(inotify_fd);
+    close(inotify_fd);
+    inotify_fd = -1;
+
+    if (is_connected) {
+        is_connected = false;
+        callback(false);
+    }
+}
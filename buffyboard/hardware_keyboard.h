@@ -0,0 +1,35 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_HARDWARE_KEYBOARD_H
+#define BB_HARDWARE_KEYBOARD_H
+
+#include <stdbool.h>
+
+/**
+ * Callback for changes in the presence of hardware keyboards.
+ *
+ * @param connected true if at least one hardware keyboard is now connected, false if the last one was removed
+ */
+typedef void (*bb_hardware_keyboard_cb)(bool connected);
+
+/**
+ * Start watching /dev/input for hardware keyboards. Buffyboard's own uinput device is ignored. If a keyboard
+ * is already connected, the callback is invoked right away. Requires the main loop and the uinput device
+ * to be initialised.
+ *
+ * @param cb callback to invoke whenever the presence of hardware keyboards changes
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_hardware_keyboard_monitor_init(bb_hardware_keyboard_cb cb);
+
+/**
+ * Stop watching for hardware keyboards. If a keyboard was connected, the callback is invoked one last time
+ * as if it had been removed.
+ */
+void bb_hardware_keyboard_monitor_stop(void);
+
+#endif /* BB_HARDWARE_KEYBOARD_H */
@@ -0,0 +1,134 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "headless.h"
+
+#include "../shared/log.h"
+
+#include <stdlib.h>
+
+
+/**
+ * Defines
+ */
+
+/* Color format of headless displays */
+#define COLOR_FORMAT LV_COLOR_FORMAT_XRGB8888
+
+
+/**
+ * Static types
+ */
+
+/* Off-screen buffer of a headless display */
+typedef struct {
+    /* Allocated memory */
+    void *unaligned_data;
+    /* Pixel data aligned as required by LVGL */
+    uint8_t *data;
+    /* Number of bytes per row */
+    uint32_t stride;
+} headless_buffer;
+
+
+/**
+ * Public variables
+ */
+
+const bb_headless_resolution bb_headless_resolutions[] = {
+    /* Nokia N900 */
+    { 480, 800 },
+    { 800, 480 },
+    /* Samsung Galaxy A3 2015 */
+    { 540, 960 },
+    { 960, 540 },
+    /* Samsung Galaxy Tab A 8.0 2015 */
+    { 768, 1024 },
+    { 1024, 768 },
+    /* Pine64 PineTab (landscape) */
+    { 1280, 800 },
+    /* Pine64 PinePhone (landscape) */
+    { 1440, 720 },
+    /* BQ Aquaris X Pro (landscape) */
+    { 1920, 1080 }
+};
+
+const int bb_headless_num_resolutions = sizeof(bb_headless_resolutions) / sizeof(bb_headless_resolutions[0]);
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Complete a flush. The display renders straight into its buffer, so there is nothing to copy.
+ *
+ * @param disp display
+ * @param area flushed area
+ * @param px_map rendered pixels
+ */
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map);
+
+
+/**
+ * Static functions
+ */
+
+static void flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map) {
+    lv_display_flush_ready(disp);
+}
+
+
+/**
+ * Public functions
+ */
+
+lv_display_t *bb_headless_display_create(int32_t width, int32_t height) {
+    headless_buffer *buf = calloc(1, sizeof(headless_buffer));
+    if (!buf) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for headless display");
+        return NULL;
+    }
+
+    buf->stride = lv_draw_buf_width_to_stride(width, COLOR_FORMAT);
+    uint32_t size = buf->stride * height;
+    buf->unaligned_data = calloc(1, size + LV_DRAW_BUF_ALIGN - 1);
+    if (!buf->unaligned_data) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate %u bytes for headless display", size);
+        free(buf);
+        return NULL;
+    }
+    buf->data = lv_draw_buf_align(buf->unaligned_data, COLOR_FORMAT);
+
+    lv_display_t *disp = lv_display_create(width, height);
+    if (!disp) {
+        free(buf->unaligned_data);
+        free(buf);
+        return NULL;
+    }
+
+    /* Render directly into a single full-size buffer so that it always holds the complete frame */
+    lv_display_set_color_format(disp, COLOR_FORMAT);
+    lv_display_set_buffers(disp, buf->data, NULL, size, LV_DISPLAY_RENDER_MODE_DIRECT);
+    lv_display_set_flush_cb(disp, flush_cb);
+    lv_display_set_driver_data(disp, buf);
+    lv_display_set_default(disp);
+
+    return disp;
+}
+
+const uint8_t *bb_headless_display_get_pixels(lv_display_t *disp, uint32_t *stride) {
+    headless_buffer *buf = lv_display_get_driver_data(disp);
+    *stride = buf->stride;
+    return buf->data;
+}
+
+void bb_headless_display_delete(lv_display_t *disp) {
+    headless_buffer *buf = lv_display_get_driver_data(disp);
+    lv_display_delete(disp);
+    free(buf->unaligned_data);
+    free(buf);
+}
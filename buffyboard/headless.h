@@ -0,0 +1,56 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_HEADLESS_H
+#define BB_HEADLESS_H
+
+#include "lvgl/lvgl.h"
+
+#include <stdint.h>
+
+/**
+ * Display resolution
+ */
+typedef struct {
+    /* Horizontal resolution */
+    int32_t width;
+    /* Vertical resolution */
+    int32_t height;
+} bb_headless_resolution;
+
+/* Resolutions of common devices that screenshots and benchmarks are rendered at */
+extern const bb_headless_resolution bb_headless_resolutions[];
+
+/* Number of entries in bb_headless_resolutions */
+extern const int bb_headless_num_resolutions;
+
+/**
+ * Create a display that renders into an off-screen XRGB8888 buffer instead of a framebuffer device.
+ * The new display becomes the default display.
+ *
+ * @param width horizontal resolution
+ * @param height vertical resolution
+ * @return the display or NULL on failure
+ */
+lv_display_t *bb_headless_display_create(int32_t width, int32_t height);
+
+/**
+ * Get the pixels that were rendered into a headless display.
+ *
+ * @param disp display created with bb_headless_display_create
+ * @param stride pointer for writing the number of bytes per row into
+ * @return the pixel data in XRGB8888 format
+ */
+const uint8_t *bb_headless_display_get_pixels(lv_display_t *disp, uint32_t *stride);
+
+/**
+ * Delete a headless display together with its screens and free its buffer.
+ *
+ * @param disp display created with bb_headless_display_create
+ */
+void bb_headless_display_delete(lv_display_t *disp);
+
+#endif /* BB_HEADLESS_H */
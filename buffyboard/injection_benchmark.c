@@ -0,0 +1,472 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "injection_benchmark.h"
+
+#include "clock.h"
+#include "key_injection.h"
+#include "layout.h"
+#include "main_loop.h"
+#include "results.h"
+#include "uinput_device.h"
+
+#include "../shared/log.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+#include <sys/ioctl.h>
+
+
+/**
+ * Defines
+ */
+
+/* Number of timed repetitions of each sample */
+#define NUM_ITERATIONS 20
+
+/* Length of each generated text sample */
+#define SAMPLE_LENGTH 4000
+
+/* Time in ms without any events after which the remaining key events of an iteration count as lost */
+#define IDLE_TIMEOUT 100
+
+/* Time in ms to wait for the event node of the uinput device to appear */
+#define NODE_TIMEOUT 1000
+
+
+/**
+ * Static types
+ */
+
+/* Injection method */
+typedef enum {
+    /* Type text through bb_key_injection_type */
+    METHOD_TYPE,
+    /* Press combinations through bb_key_injection_press */
+    METHOD_KEYS,
+    /* Emit the scancodes of text with one write per event like individual key presses */
+    METHOD_PER_KEY_WRITES
+} method;
+
+/* Input that is injected repeatedly */
+typedef struct {
+    /* Name of the sample */
+    const char *name;
+    /* Injection method */
+    method method;
+    /* Characters the text is made up of, repeated until SAMPLE_LENGTH, or the combinations to press */
+    const char *input;
+} sample;
+
+
+/**
+ * Static variables
+ */
+
+static int evdev_fd = -1;
+static int num_received = 0;
+static int num_syn_dropped = 0;
+static uint64_t last_event_time = 0;
+
+static const sample samples[] = {
+    { "lowercase", METHOD_TYPE, "the quick brown fox jumps over the lazy dog " },
+    { "mixed", METHOD_TYPE, "Hello, World! 42 * (x + y) = [z]; path=/usr/bin:~/.local \\n" },
+    { "keys", METHOD_KEYS, "29+46 29+32 56+15 103 108 105 106 28 1 29+42+20" },
+    { "per_key_writes", METHOD_PER_KEY_WRITES, "the quick brown fox jumps over the lazy dog " }
+};
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Compare two durations for sorting.
+ *
+ * @param a first duration
+ * @param b second duration
+ * @return negative, zero or positive if a is less than, equal to or greater than b
+ */
+static int compare_durations(const void *a, const void *b);
+
+/**
+ * Repeat a sample's characters up to SAMPLE_LENGTH bytes without splitting escape sequences.
+ *
+ * @param s sample to expand
+ * @return newly allocated text or NULL on failure
+ */
+static char *expand_text(const sample *s);
+
+/**
+ * Emit the key events of combinations with one write per event, as the keyboard does for individual key presses.
+ *
+ * @param combos combinations of scancodes in the format accepted by bb_key_injection_press
+ * @return true on success, false otherwise
+ */
+static bool emit_per_key(const char *combos);
+
+/**
+ * Convert text into the scancode combinations of the current layout so that the per-key baseline emits the same
+ * events as typing and the number of expected key events is known.
+ *
+ * @param text text to convert
+ * @return newly allocated combinations in the format accepted by bb_key_injection_press or NULL on failure
+ */
+static char *text_to_combos(const char *text);
+
+/**
+ * Count the key down and up events that pressing combinations produces.
+ *
+ * @param combos combinations in the format accepted by bb_key_injection_press
+ * @return number of key events
+ */
+static int count_key_events(const char *combos);
+
+/**
+ * Open the event node of the uinput device for reading.
+ *
+ * @return file descriptor or -1 on failure
+ */
+static int open_evdev_node(void);
+
+/**
+ * Read back all available events from the uinput device's event node.
+ *
+ * @param fd file descriptor of the event node
+ * @param user_data unused
+ */
+static void evdev_cb(int fd, void *user_data);
+
+/**
+ * Run the main loop until the expected number of key events was read back or none arrived for IDLE_TIMEOUT.
+ *
+ * @param expected number of expected key events
+ * @return true on success, false if the main loop failed
+ */
+static bool wait_for_events(int expected);
+
+
+/**
+ * Static functions
+ */
+
+static int compare_durations(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static char *expand_text(const sample *s) {
+    size_t length = strlen(s->input);
+    char *text = malloc(SAMPLE_LENGTH + length + 1);
+    if (!text) {
+        return NULL;
+    }
+
+    size_t size = 0;
+    while (size < SAMPLE_LENGTH) {
+        memcpy(text + size, s->input, length);
+        size += length;
+    }
+    text[size] = '\0';
+    return text;
+}
+
+static bool emit_per_key(const char *combos) {
+    for (const char *c = combos; *c; ) {
+        char *end = NULL;
+        int scancodes[8];
+        int num_scancodes = 0;
+
+        while (num_scancodes < 8) {
+            scancodes[num_scancodes++] = (int)strtol(c, &end, 10);
+            c = end;
+            if (*c != '+') {
+                break;
+            }
+            ++c;
+        }
+
+        for (int i = 0; i < num_scancodes; ++i) {
+            if (!bb_uinput_device_emit_key_down(scancodes[i])) {
+                return false;
+            }
+        }
+        for (int i = num_scancodes - 1; i >= 0; --i) {
+            if (!bb_uinput_device_emit_key_up(scancodes[i])) {
+                return false;
+            }
+        }
+
+        while (*c == ' ') {
+            ++c;
+        }
+    }
+    return true;
+}
+
+static char *text_to_combos(const char *text) {
+    /* Each character maps to at most BB_LAYOUT_MAX_KEY_SCANCODES scancodes of up to three digits */
+    size_t length = strlen(text);
+    char *combos = malloc(length * BB_LAYOUT_MAX_KEY_SCANCODES * 4 + 1);
+    if (!combos) {
+        return NULL;
+    }
+
+    const bb_layout *layout = bb_layout_get_current();
+    size_t size = 0;
+    for (const char *c = text; *c; ++c) {
+        /* The only escape sequence used by the samples stands for Enter */
+        if (*c == '\\' && c[1] == 'n') {
+            size += sprintf(combos + size, "%s%d", size > 0 ? " " : "", KEY_ENTER);
+            ++c;
+            continue;
+        }
+
+        const bb_layout_key *found = NULL;
+        for (int l = 0; l < layout->num_layers && !found; ++l) {
+            if (!bb_layout_prepare_layer(l)) {
+                continue;
+            }
+            const bb_layout_layer *layer = &layout->layers[l];
+            int btn_id = 0;
+            for (int i = 0; layer->keycaps[i][0] != '\0' && !found; ++i) {
+                if (strcmp(layer->keycaps[i], "\n") == 0) {
+                    continue;
+                }
+                const bb_layout_key *key = &layer->keys[btn_id++];
+                if (key->num_scancodes > 0 && layer->keycaps[i][0] == *c && layer->keycaps[i][1] == '\0') {
+                    found = key;
+                }
+            }
+        }
+        if (!found) {
+            free(combos);
+            return NULL;
+        }
+
+        for (int i = 0; i < found->num_scancodes; ++i) {
+            size += sprintf(combos + size, "%s%u", i > 0 ? "+" : (size > 0 ? " " : ""), found->scancodes[i]);
+        }
+    }
+    combos[size] = '\0';
+    return combos;
+}
+
+static int count_key_events(const char *combos) {
+    int num_scancodes = (*combos != '\0') ? 1 : 0;
+    for (const char *c = combos; *c; ++c) {
+        if (*c == '+' || *c == ' ') {
+            ++num_scancodes;
+        }
+    }
+    return 2 * num_scancodes;
+}
+
+static int open_evdev_node(void) {
+    char sysname[64];
+    if (!bb_uinput_device_get_sysname(sysname, sizeof(sysname))) {
+        return -1;
+    }
+
+    char dir_path[PATH_MAX];
+    snprintf(dir_path, sizeof(dir_path), "/sys/class/input/%s", sysname);
+
+    /* The event node only shows up once the kernel and udev have processed the new device */
+    uint64_t deadline = bb_clock_now() + NODE_TIMEOUT * 1000;
+    do {
+        DIR *dir = opendir(dir_path);
+        struct dirent *entry;
+        while (dir && (entry = readdir(dir)) != NULL) {
+            if (strncmp(entry->d_name, "event", 5) != 0) {
+                continue;
+            }
+
+            char node_path[PATH_MAX];
+            snprintf(node_path, sizeof(node_path), "/dev/input/%s", entry->d_name);
+            int fd = open(node_path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+            if (fd >= 0) {
+                closedir(dir);
+                return fd;
+            }
+        }
+        if (dir) {
+            closedir(dir);
+        }
+        usleep(10000);
+    } while (bb_clock_now() < deadline);
+
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Could not open the event node of uinput device %s", sysname);
+    return -1;
+}
+
+static void evdev_cb(int fd, void *user_data) {
+    struct input_event events[64];
+    ssize_t size;
+
+    while ((size = read(fd, events, sizeof(events))) > 0) {
+        bool has_keys = false;
+        for (size_t i = 0; i < (size_t)size / sizeof(struct input_event); ++i) {
+            if (events[i].type == EV_KEY) {
+                ++num_received;
+                has_keys = true;
+            } else if (events[i].type == EV_SYN && events[i].code == SYN_DROPPED) {
+                ++num_syn_dropped;
+            }
+        }
+        if (has_keys) {
+            last_event_time = bb_clock_now();
+        }
+    }
+}
+
+static bool wait_for_events(int expected) {
+    while (num_received < expected) {
+        int num_ready = bb_main_loop_dispatch(IDLE_TIMEOUT);
+        if (num_ready < 0) {
+            return false;
+        }
+        if (num_ready == 0) {
+            break;
+        }
+    }
+    return true;
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_injection_benchmark_run(const char *path) {
+    if (!bb_layout_switch(bb_layout_default_name)) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not select layout %s", bb_layout_default_name);
+        return false;
+    }
+
+    /* Register the same scancodes as the real device so that the same combinations are accepted */
+    int *scancodes = NULL;
+    int num_scancodes = 0;
+    if (!bb_layout_collect_scancodes(&scancodes, &num_scancodes)) {
+        return false;
+    }
+
+    if (!bb_main_loop_init()) {
+        free(scancodes);
+        return false;
+    }
+
+    bool is_created = bb_uinput_device_init(scancodes, num_scancodes);
+    free(scancodes);
+    if (!is_created) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: could not create a uinput device, the benchmark needs write access to "
+            "/dev/uinput");
+        return false;
+    }
+
+    /* Read the events back like a compositor or the console would. Grabbing the device keeps the typed text
+     * away from everybody else. */
+    evdev_fd = open_evdev_node();
+    if (evdev_fd < 0) {
+        return false;
+    }
+    if (ioctl(evdev_fd, EVIOCGRAB, 1) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: could not grab the uinput device, not typing into other applications");
+        close(evdev_fd);
+        return false;
+    }
+    if (!bb_main_loop_add_fd(evdev_fd, evdev_cb, NULL)) {
+        close(evdev_fd);
+        return false;
+    }
+
+    char fields[128];
+    snprintf(fields, sizeof(fields), "\"layout\":\"%s\"", bb_layout_default_name);
+
+    bb_results results;
+    if (!bb_results_open(&results, path, NUM_ITERATIONS, fields)) {
+        bb_main_loop_remove_fd(evdev_fd);
+        close(evdev_fd);
+        return false;
+    }
+
+    bool success = true;
+    uint64_t durations[NUM_ITERATIONS];
+    for (size_t s = 0; s < sizeof(samples) / sizeof(samples[0]) && success; ++s) {
+        const sample *smp = &samples[s];
+        char *text = (smp->method == METHOD_KEYS) ? NULL : expand_text(smp);
+        char *combos = text ? text_to_combos(text) : NULL;
+        if (smp->method != METHOD_KEYS && !combos) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: could not prepare sample %s", smp->name);
+            free(text);
+            success = false;
+            break;
+        }
+        const char *input = text ? text : smp->input;
+        int num_expected = count_key_events(combos ? combos : smp->input);
+
+        int num_chars = 0;
+        int num_lost = 0;
+        char error[256] = "";
+        uint64_t total = 0;
+        num_syn_dropped = 0;
+        for (int i = 0; i < NUM_ITERATIONS && success; ++i) {
+            num_received = 0;
+            uint64_t start = bb_clock_now();
+            last_event_time = start;
+            switch (smp->method) {
+                case METHOD_TYPE:
+                    success = bb_key_injection_type(input, &num_chars, error, sizeof(error));
+                    break;
+                case METHOD_KEYS:
+                    success = bb_key_injection_press(input, &num_chars, error, sizeof(error));
+                    break;
+                case METHOD_PER_KEY_WRITES:
+                    success = emit_per_key(combos);
+                    num_chars = (int)strlen(input);
+                    break;
+            }
+
+            /* The time until the last key event was read back includes the pauses between batches */
+            success = success && wait_for_events(num_expected);
+            num_lost += (num_received < num_expected) ? num_expected - num_received : 0;
+            durations[i] = last_event_time - start;
+            total += durations[i];
+        }
+
+        if (!success) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: could not inject sample %s: %s", smp->name, error);
+        } else {
+            qsort(durations, NUM_ITERATIONS, sizeof(uint64_t), compare_durations);
+            double seconds = total / 1000000.0;
+            bb_results_add(&results, "\"sample\":\"%s\",\"chars\":%d,\"median_us\":%llu,\"chars_per_s\":%.0f,"
+                "\"syn_dropped\":%d,\"lost_events\":%d",
+                smp->name, num_chars, (unsigned long long)durations[NUM_ITERATIONS / 2],
+                seconds > 0 ? (double)num_chars * NUM_ITERATIONS / seconds : 0.0, num_syn_dropped, num_lost);
+        }
+
+        free(combos);
+        free(text);
+    }
+
+    bb_main_loop_remove_fd(evdev_fd);
+    close(evdev_fd);
+
+    if (!bb_results_close(&results)) {
+        return false;
+    }
+
+    return success;
+}
@@ -0,0 +1,22 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_INJECTION_BENCHMARK_H
+#define BB_INJECTION_BENCHMARK_H
+
+#include <stdbool.h>
+
+/**
+ * Inject text and key combinations through the default layout into a grabbed uinput device, read the key events
+ * back from its event node and write the throughput in characters per second and the number of lost events as
+ * JSON. Per-key writes without pauses are measured alongside as a baseline for batching.
+ *
+ * @param path path of the file to write the results to or NULL to write them to STDOUT
+ * @return true on success, false otherwise
+ */
+bool bb_injection_benchmark_run(const char *path);
+
+#endif /* BB_INJECTION_BENCHMARK_H */
@@ -0,0 +1,533 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "key_injection.h"
+
+#include "layout.h"
+#include "main_loop.h"
+#include "stats.h"
+#include "trace.h"
+#include "uinput_device.h"
+
+#include "../shared/log.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+#include <sys/timerfd.h>
+
+
+/**
+ * Defines
+ */
+
+/* Maximum number of keys in a combination. Pressing and releasing them must fit into a single batch. */
+#define MAX_COMBO_KEYS (BB_UINPUT_DEVICE_MAX_BATCH / 2)
+
+/* Maximum number of combinations waiting to be emitted with a pause in between */
+#define MAX_PENDING_COMBOS 4096
+
+
+/**
+ * Static types
+ */
+
+/* Keys that are pressed together */
+typedef struct {
+    /* Scancodes in the order of pressing */
+    uint16_t scancodes[MAX_COMBO_KEYS];
+    /* Number of scancodes */
+    int num_scancodes;
+} combo;
+
+
+/**
+ * Static variables
+ */
+
+static uint32_t delay = 0;
+static combo pending[MAX_PENDING_COMBOS];
+static int pending_start = 0;
+static int num_pending = 0;
+static int timer_fd = -1;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Find the key with a single scancode in the current layout.
+ *
+ * @param scancode scancode to look for
+ * @param c pointer for writing the key into
+ * @return true if the key was found, false otherwise
+ */
+static bool find_key_with_scancode(uint16_t scancode, combo *c);
+
+/**
+ * Find the key with a key cap in the current layout. Keys without scancodes are skipped.
+ *
+ * @param keycap key cap to look for
+ * @param length length of the key cap in bytes
+ * @param c pointer for writing the key into
+ * @return true if the key was found, false otherwise
+ */
+static bool find_key_with_keycap(const char *keycap, size_t length, combo *c);
+
+/**
+ * Map all single-byte key caps of the current layout. Where several keys share a key cap, the first one wins.
+ *
+ * @param table table indexed by character for writing the keys into, keys without a mapping have no scancodes
+ */
+static void build_ascii_table(combo *table);
+
+/**
+ * Get the length of a UTF-8 sequence from its first byte.
+ *
+ * @param byte first byte of the sequence
+ * @return length in bytes or 0 if the byte can't start a sequence
+ */
+static size_t get_utf8_length(unsigned char byte);
+
+/**
+ * Check that the uinput device can emit all keys of some combinations.
+ *
+ * @param combos combinations to check
+ * @param num_combos number of combinations
+ * @param error buffer for writing an error message into
+ * @param error_size size of the error buffer
+ * @return true if all keys can be emitted, false otherwise
+ */
+static bool check_registered(const combo *combos, int num_combos, char *error, size_t error_size);
+
+/**
+ * Count how many of the leading combinations fit into a single batch of key events. The first combination
+ * always fits.
+ *
+ * @param combos combinations to emit
+ * @param num_combos number of combinations
+ * @return number of combinations in the batch
+ */
+static int count_batch(const combo *combos, int num_combos);
+
+/**
+ * Turn combinations into key events and emit them at once. The key events must fit into a single batch.
+ *
+ * @param combos combinations to emit
+ * @param num_combos number of combinations
+ * @return true on success, false otherwise
+ */
+static bool emit_combos(const combo *combos, int num_combos);
+
+/**
+ * Emit combinations right away or queue them for pacing.
+ *
+ * @param combos combinations to emit
+ * @param num_combos number of combinations
+ * @param error buffer for writing an error message into
+ * @param error_size size of the error buffer
+ * @return true on success, false otherwise
+ */
+static bool submit(const combo *combos, int num_combos, char *error, size_t error_size);
+
+/**
+ * Arm or disarm the pacing timer.
+ *
+ * @param is_armed true to emit pending combinations periodically, false to stop
+ * @return true on success, false otherwise
+ */
+static bool set_timer_armed(bool is_armed);
+
+/**
+ * Emit pending combinations, one per elapsed pause or a batch at a time without a pause.
+ *
+ * @param fd timer file descriptor
+ * @param user_data unused
+ */
+static void timer_cb(int fd, void *user_data);
+
+
+/**
+ * Static functions
+ */
+
+static bool find_key_with_scancode(uint16_t scancode, combo *c) {
+    const bb_layout *layout = bb_layout_get_current();
+    for (int l = 0; layout && l < layout->num_layers; ++l) {
+        const bb_layout_layer *layer = &layout->layers[l];
+        for (int i = 0; i < layer->num_keys; ++i) {
+            if (layer->keys[i].num_scancodes == 1 && layer->keys[i].scancodes[0] == scancode) {
+                c->scancodes[0] = scancode;
+                c->num_scancodes = 1;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static bool find_key_with_keycap(const char *keycap, size_t length, combo *c) {
+    const bb_layout *layout = bb_layout_get_current();
+    for (int l = 0; layout && l < layout->num_layers; ++l) {
+        /* Key caps of layouts loaded from files are only unpacked on demand */
+        if (!bb_layout_prepare_layer(l)) {
+            continue;
+        }
+
+        const bb_layout_layer *layer = &layout->layers[l];
+        int btn_id = 0;
+        for (int i = 0; layer->keycaps[i][0] != '\0' && btn_id < layer->num_keys; ++i) {
+            if (strcmp(layer->keycaps[i], "\n") == 0) {
+                continue;
+            }
+
+            const bb_layout_key *key = &layer->keys[btn_id++];
+            if (key->num_scancodes > 0 && strlen(layer->keycaps[i]) == length
+                    && memcmp(layer->keycaps[i], keycap, length) == 0) {
+                memcpy(c->scancodes, key->scancodes, key->num_scancodes * sizeof(uint16_t));
+                c->num_scancodes = key->num_scancodes;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+static void build_ascii_table(combo *table) {
+    memset(table, 0, 128 * sizeof(combo));
+
+    const bb_layout *layout = bb_layout_get_current();
+    for (int l = 0; layout && l < layout->num_layers; ++l) {
+        if (!bb_layout_prepare_layer(l)) {
+            continue;
+        }
+
+        const bb_layout_layer *layer = &layout->layers[l];
+        int btn_id = 0;
+        for (int i = 0; layer->keycaps[i][0] != '\0' && btn_id < layer->num_keys; ++i) {
+            const unsigned char *keycap = (const unsigned char *)layer->keycaps[i];
+            if (strcmp(layer->keycaps[i], "\n") == 0) {
+                continue;
+            }
+
+            const bb_layout_key *key = &layer->keys[btn_id++];
+            if (key->num_scancodes > 0 && keycap[0] < 128 && keycap[1] == '\0'
+                    && table[keycap[0]].num_scancodes == 0) {
+                memcpy(table[keycap[0]].scancodes, key->scancodes, key->num_scancodes * sizeof(uint16_t));
+                table[keycap[0]].num_scancodes = key->num_scancodes;
+            }
+        }
+    }
+
+    /* Control characters don't have key caps of their own */
+    find_key_with_scancode(KEY_ENTER, &table['\n']);
+    find_key_with_scancode(KEY_TAB, &table['\t']);
+}
+
+static size_t get_utf8_length(unsigned char byte) {
+    if (byte < 0x80) {
+        return 1;
+    }
+    if ((byte & 0xe0) == 0xc0) {
+        return 2;
+    }
+    if ((byte & 0xf0) == 0xe0) {
+        return 3;
+    }
+    if ((byte & 0xf8) == 0xf0) {
+        return 4;
+    }
+    return 0;
+}
+
+static bool check_registered(const combo *combos, int num_combos, char *error, size_t error_size) {
+    for (int i = 0; i < num_combos; ++i) {
+        for (int j = 0; j < combos[i].num_scancodes; ++j) {
+            if (!bb_uinput_device_can_emit(combos[i].scancodes[j])) {
+                snprintf(error, error_size, "key %u isn't supported by the uinput device",
+                    (unsigned int)combos[i].scancodes[j]);
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static int count_batch(const combo *combos, int num_combos) {
+    int count = 1;
+    int num_events = 2 * combos[0].num_scancodes;
+    while (count < num_combos && num_events + 2 * combos[count].num_scancodes <= BB_UINPUT_DEVICE_MAX_BATCH) {
+        num_events += 2 * combos[count].num_scancodes;
+        ++count;
+    }
+    return count;
+}
+
+static bool emit_combos(const combo *combos, int num_combos) {
+    bb_uinput_device_key_event events[BB_UINPUT_DEVICE_MAX_BATCH];
+    int num_events = 0;
+
+    /* Press the keys of each combination in order and release them in reverse like the on-screen keyboard */
+    for (int i = 0; i < num_combos; ++i) {
+        for (int j = 0; j < combos[i].num_scancodes; ++j) {
+            events[num_events++] = (bb_uinput_device_key_event){ combos[i].scancodes[j], true };
+        }
+        for (int j = combos[i].num_scancodes - 1; j >= 0; --j) {
+            events[num_events++] = (bb_uinput_device_key_event){ combos[i].scancodes[j], false };
+        }
+        bb_stats_count_key_event();
+    }
+
+    return bb_uinput_device_emit_keys(events, num_events);
+}
+
+static bool submit(const combo *combos, int num_combos, char *error, size_t error_size) {
+    if (num_combos == 0) {
+        return true;
+    }
+
+    /* The kernel would silently drop keys that the device wasn't set up with, e.g. from layouts added later */
+    if (!check_registered(combos, num_combos, error, error_size)) {
+        return false;
+    }
+
+    /* Without a pause, emit the first batch right away unless earlier requests are still being paced. The rest
+     * follows one batch per main loop iteration so that readers can empty their evdev buffers in between. */
+    int num_immediate = (delay == 0 && num_pending == 0) ? count_batch(combos, num_combos) : 0;
+
+    if (num_combos - num_immediate > MAX_PENDING_COMBOS - num_pending) {
+        snprintf(error, error_size, "too many pending keys");
+        return false;
+    }
+
+    if (num_immediate > 0 && !emit_combos(combos, num_immediate)) {
+        snprintf(error, error_size, "could not emit key events");
+        return false;
+    }
+
+    combos += num_immediate;
+    num_combos -= num_immediate;
+    if (num_combos == 0) {
+        return true;
+    }
+
+    for (int i = 0; i < num_combos; ++i) {
+        pending[(pending_start + num_pending + i) % MAX_PENDING_COMBOS] = combos[i];
+    }
+    num_pending += num_combos;
+
+    if (!set_timer_armed(true)) {
+        num_pending -= num_combos;
+        snprintf(error, error_size, "could not start pacing");
+        return false;
+    }
+    return true;
+}
+
+static bool set_timer_armed(bool is_armed) {
+    if (timer_fd < 0) {
+        timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+        if (timer_fd < 0) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "Could not create pacing timer: %s", strerror(errno));
+            return false;
+        }
+
+        /* A file descriptor keeps pacing going even while LVGL's timers are paused with the keyboard hidden */
+        if (!bb_main_loop_add_fd(timer_fd, timer_cb, NULL)) {
+            close(timer_fd);
+            timer_fd = -1;
+            return false;
+        }
+    }
+
+    /* Without a pause, emit a batch every millisecond. That is as fast as the timer goes and still leaves readers
+     * time to empty their buffers. */
+    uint32_t period = (delay > 0) ? delay : 1;
+    struct itimerspec spec;
+    memset(&spec, 0, sizeof(spec));
+    if (is_armed) {
+        spec.it_interval.tv_sec = period / 1000;
+        spec.it_interval.tv_nsec = (period % 1000) * 1000000L;
+        spec.it_value = spec.it_interval;
+    }
+
+    if (timerfd_settime(timer_fd, 0, &spec, NULL) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not set pacing timer: %s", strerror(errno));
+        return false;
+    }
+    return true;
+}
+
+static void timer_cb(int fd, void *user_data) {
+    uint64_t expirations = 0;
+    if (read(fd, &expirations, sizeof(expirations)) != sizeof(expirations)) {
+        return;
+    }
+
+    /* Catch up on pauses that elapsed while the main loop was busy, but never emit more than a batch at once.
+     * Without a pause, a whole batch is due on every expiration. Batches stop where the queue wraps around. */
+    uint64_t trace_start = bb_trace_begin();
+    int max_combos = (delay > 0 && expirations < (uint64_t)num_pending) ? (int)expirations : num_pending;
+    if (max_combos > MAX_PENDING_COMBOS - pending_start) {
+        max_combos = MAX_PENDING_COMBOS - pending_start;
+    }
+
+    int count = count_batch(&pending[pending_start], max_combos);
+    if (emit_combos(&pending[pending_start], count)) {
+        pending_start = (pending_start + count) % MAX_PENDING_COMBOS;
+        num_pending -= count;
+    } else {
+        /* Typing the rest would produce garbled text, so give up on everything that is still waiting */
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not emit paced keys, dropping %d pending key combinations", num_pending);
+        num_pending = 0;
+    }
+    bb_trace_end("key injection", trace_start);
+
+    if (num_pending == 0) {
+        pending_start = 0;
+        set_timer_armed(false);
+    }
+}
+
+
+/**
+ * Public functions
+ */
+
+void bb_key_injection_set_delay(uint32_t new_delay) {
+    delay = new_delay;
+
+    /* Apply the new pause to keys that are still waiting */
+    if (num_pending > 0) {
+        set_timer_armed(true);
+    }
+}
+
+bool bb_key_injection_type(const char *text, int *num_chars, char *error, size_t error_size) {
+    *num_chars = 0;
+    uint64_t trace_start = bb_trace_begin();
+
+    combo *combos = malloc((strlen(text) + 1) * sizeof(combo));
+    if (!combos) {
+        snprintf(error, error_size, "out of memory");
+        return false;
+    }
+
+    combo ascii[128];
+    build_ascii_table(ascii);
+
+    /* Map everything before typing anything so that a bad character doesn't leave half of the text typed */
+    int count = 0;
+    for (const char *c = text; *c; ) {
+        size_t length = get_utf8_length((unsigned char)*c);
+        char ch = *c;
+        if (ch == '\\') {
+            switch (c[1]) {
+                case 'n':
+                    ch = '\n';
+                    break;
+                case 't':
+                    ch = '\t';
+                    break;
+                case '\\':
+                    break;
+                default:
+                    snprintf(error, error_size, "invalid escape sequence at offset %d", (int)(c - text));
+                    free(combos);
+                    return false;
+            }
+            length = 2;
+        }
+
+        if (length == 0 || strnlen(c, length) < length) {
+            snprintf(error, error_size, "invalid UTF-8 at offset %d", (int)(c - text));
+            free(combos);
+            return false;
+        }
+
+        combo *current = &combos[count];
+        bool is_single = (length == 1 || *c == '\\');
+        if (is_single) {
+            *current = ascii[(unsigned char)ch];
+        }
+        if (is_single ? current->num_scancodes == 0 : !find_key_with_keycap(c, length, current)) {
+            snprintf(error, error_size, "no key for \"%.*s\" at offset %d", (int)length, c, (int)(c - text));
+            free(combos);
+            return false;
+        }
+        ++count;
+        c += length;
+    }
+
+    bool success = submit(combos, count, error, error_size);
+    free(combos);
+    bb_trace_end("key injection", trace_start);
+
+    if (success) {
+        *num_chars = count;
+    }
+    return success;
+}
+
+bool bb_key_injection_press(const char *combos, int *num_combos, char *error, size_t error_size) {
+    *num_combos = 0;
+
+    /* Each combination takes up at least two characters including the separator */
+    combo *parsed = malloc((strlen(combos) / 2 + 1) * sizeof(combo));
+    if (!parsed) {
+        snprintf(error, error_size, "out of memory");
+        return false;
+    }
+
+    int count = 0;
+    const char *c = combos;
+    while (*c) {
+        if (*c == ' ') {
+            ++c;
+            continue;
+        }
+
+        combo *current = &parsed[count];
+        current->num_scancodes = 0;
+        while (true) {
+            char *end = NULL;
+            long scancode = strtol(c, &end, 10);
+            if (end == c || scancode <= 0 || scancode > KEY_MAX || current->num_scancodes == MAX_COMBO_KEYS) {
+                snprintf(error, error_size, "invalid key combination at offset %d", (int)(c - combos));
+                free(parsed);
+                return false;
+            }
+            current->scancodes[current->num_scancodes++] = (uint16_t)scancode;
+
+            c = end;
+            if (*c != '+') {
+                break;
+            }
+            ++c;
+        }
+
+        if (*c != ' ' && *c != '\0') {
+            snprintf(error, error_size, "invalid key combination at offset %d", (int)(c - combos));
+            free(parsed);
+            return false;
+        }
+        ++count;
+    }
+
+    bool success = submit(parsed, count, error, error_size);
+    free(parsed);
+
+    if (success) {
+        *num_combos = count;
+    }
+    return success;
+}
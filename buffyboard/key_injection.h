@@ -0,0 +1,52 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_KEY_INJECTION_H
+#define BB_KEY_INJECTION_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Set the pause between injected characters or key combinations. Without a pause, key events are written to the
+ * uinput device in batches of up to BB_UINPUT_DEVICE_MAX_BATCH, one per millisecond. Paced key events and all
+ * batches after the first are emitted from the main loop. The main loop must be initialised before keys are
+ * injected.
+ *
+ * @param delay pause in ms or 0 to disable pacing
+ */
+void bb_key_injection_set_delay(uint32_t delay);
+
+/**
+ * Type text through the uinput device by mapping each character to a key of the current layout, including keys
+ * on layers other than the current one such as the uppercase layer. The escape sequences \n, \t and \\ stand for
+ * Enter, Tab and a backslash. Nothing is typed unless all characters can be mapped to keys that the uinput device
+ * can emit.
+ *
+ * @param text UTF-8 text to type
+ * @param num_chars pointer for writing the number of typed characters into
+ * @param error buffer for writing an error message into
+ * @param error_size size of the error buffer
+ * @return true if the text was typed or queued, false otherwise
+ */
+bool bb_key_injection_type(const char *text, int *num_chars, char *error, size_t error_size);
+
+/**
+ * Press key combinations through the uinput device. Combinations are separated by spaces and consist of
+ * scancodes joined by "+" (e.g. "29+46" for Ctrl+C). The keys of each combination are pressed in order and
+ * released in reverse order. Nothing is pressed unless all combinations are valid and only use keys that the
+ * uinput device can emit.
+ *
+ * @param combos key combinations to press
+ * @param num_combos pointer for writing the number of pressed combinations into
+ * @param error buffer for writing an error message into
+ * @param error_size size of the error buffer
+ * @return true if the combinations were pressed or queued, false otherwise
+ */
+bool bb_key_injection_press(const char *combos, int *num_combos, char *error, size_t error_size);
+
+#endif /* BB_KEY_INJECTION_H */
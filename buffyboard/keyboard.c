@@ -0,0 +1,285 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "keyboard.h"
+
+#include "layout.h"
+#include "stats.h"
+#include "trace.h"
+
+#include "../shared/log.h"
+#include "../shared/theme.h"
+
+#include <stdlib.h>
+
+
+/**
+ * Static variables
+ */
+
+static bb_keyboard_key_cb key_cb = NULL;
+
+/* Keyboard widgets per layer of the current layout, NULL for layers that weren't shown yet */
+static lv_obj_t **layer_keyboards = NULL;
+static lv_obj_t *active_keyboard = NULL;
+static bool popovers = false;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Handle LV_EVENT_VALUE_CHANGED events from the keyboard widget.
+ *
+ * @param event the event object
+ */
+static void keyboard_value_changed_cb(lv_event_t *event);
+
+/**
+ * Emit key down and up events for a key.
+ *
+ * @param layer_keyboard keyboard widget of the current layer
+ * @param btn_id button index corresponding to the key
+ * @param key_down true if a key down event should be emitted
+ * @param key_up true if a key up event should be emitted
+ */
+static void emit_key_events(lv_obj_t *layer_keyboard, uint16_t btn_id, bool key_down, bool key_up);
+
+/**
+ * Release any previously pressed modifier keys on the current layer.
+ *
+ * @param layer_keyboard keyboard widget of the current layer
+ */
+static void release_modifiers(lv_obj_t *layer_keyboard);
+
+/**
+ * Hand a layer's key caps and attributes to its keyboard widget.
+ *
+ * @param layer_keyboard keyboard widget
+ * @param layer layer to apply
+ */
+static void apply_layer(lv_obj_t *layer_keyboard, const bb_layout_layer *layer);
+
+/**
+ * Create the keyboard widget for a layer of the current layout.
+ *
+ * @param keyboard container holding the keyboard widgets
+ * @param layer layer to show in the widget
+ * @return the keyboard widget
+ */
+static lv_obj_t *create_layer_keyboard(lv_obj_t *keyboard, const bb_layout_layer *layer);
+
+
+/**
+ * Static functions
+ */
+
+static void keyboard_value_changed_cb(lv_event_t *event) {
+    uint64_t start = bb_trace_begin();
+    lv_obj_t *kb = lv_event_get_target(event);
+
+    uint16_t btn_id = lv_buttonmatrix_get_selected_button(kb);
+    if (btn_id == LV_BUTTONMATRIX_BUTTON_NONE) {
+        bb_trace_end("keyboard value changed", start);
+        return;
+    }
+
+    int dest = bb_layout_get_switcher_dest(btn_id);
+    if (dest >= 0) {
+        uint64_t switch_start = bb_trace_begin();
+        bb_keyboard_set_layer(lv_obj_get_parent(kb), dest);
+        bb_trace_end("layer switch", switch_start);
+        bb_trace_end("keyboard value changed", start);
+        return;
+    }
+
+    /* Note that the LV_BUTTONMATRIX_CTRL_CHECKED logic is inverted because LV_KEYBOARD_CTRL_BTN_FLAGS already
+     * contains LV_BUTTONMATRIX_CTRL_CHECKED. As a result, pressing e.g. CTRL will _un_check the key. To account
+     * for this, we invert the meaning of "checked" here and elsewhere in the code. */
+
+    bool is_modifier = bb_layout_is_modifier(btn_id);
+    bool is_checked = !lv_buttonmatrix_has_button_ctrl(kb, btn_id, LV_BUTTONMATRIX_CTRL_CHECKED);
+
+    /* Emit key events. Suppress key up events for modifiers unless they were unchecked. For checked modifiers
+     * the key up events are sent with the next non-modifier key press. */
+    emit_key_events(kb, btn_id, true, !is_modifier || !is_checked);
+
+    /* Pop any previously checked modifiers when a non-modifier key was pressed */
+    if (!is_modifier) {
+        release_modifiers(kb);
+    }
+
+    bb_trace_end("keyboard value changed", start);
+}
+
+static void emit_key_events(lv_obj_t *layer_keyboard, uint16_t btn_id, bool key_down, bool key_up) {
+    int num_scancodes = 0;
+    const uint16_t *scancodes = bb_layout_get_scancodes(btn_id, &num_scancodes);
+
+    if (key_down) {
+        bb_stats_count_key_event();
+
+        /* Emit key down events in forward order */
+        for (int i = 0; i < num_scancodes; ++i) {
+            key_cb(scancodes[i], true);
+        }
+    }
+
+    if (key_up) {
+        /* Emit key up events in backward order */
+        for (int i = num_scancodes - 1; i >= 0; --i) {
+            key_cb(scancodes[i], false);
+        }
+    }
+}
+
+static void release_modifiers(lv_obj_t *layer_keyboard) {
+    int num_modifiers = 0;
+    const uint16_t *modifier_idxs = bb_layout_get_modifier_indexes(&num_modifiers);
+
+    for (int i = 0; i < num_modifiers; ++i) {
+        if (!lv_buttonmatrix_has_button_ctrl(layer_keyboard, modifier_idxs[i], LV_BUTTONMATRIX_CTRL_CHECKED)) {
+            emit_key_events(layer_keyboard, modifier_idxs[i], false, true);
+            lv_buttonmatrix_set_button_ctrl(layer_keyboard, modifier_idxs[i], LV_BUTTONMATRIX_CTRL_CHECKED);
+        }
+    }
+}
+
+static void apply_layer(lv_obj_t *layer_keyboard, const bb_layout_layer *layer) {
+    /* LVGL keeps keyboard maps in variables shared by all keyboard widgets and rereads them whenever the
+     * popover setting changes, so the map has to be set again right before that */
+    lv_keyboard_set_map(layer_keyboard, LV_KEYBOARD_MODE_TEXT_LOWER, layer->keycaps, layer->attributes);
+    lv_keyboard_set_popovers(layer_keyboard, popovers);
+}
+
+static lv_obj_t *create_layer_keyboard(lv_obj_t *keyboard, const bb_layout_layer *layer) {
+    lv_obj_t *layer_keyboard = lv_keyboard_create(keyboard);
+    uint32_t num_keyboard_events = lv_obj_get_event_count(layer_keyboard);
+    for(uint32_t i = 0; i < num_keyboard_events; ++i) {
+        if(lv_event_dsc_get_cb(lv_obj_get_event_dsc(layer_keyboard, i)) == lv_keyboard_def_event_cb) {
+            lv_obj_remove_event(layer_keyboard, i);
+            break;
+        }
+    }
+    lv_obj_add_event_cb(layer_keyboard, keyboard_value_changed_cb, LV_EVENT_VALUE_CHANGED, NULL);
+    lv_obj_add_flag(layer_keyboard, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_set_pos(layer_keyboard, 0, 0);
+    lv_obj_set_size(layer_keyboard, lv_pct(100), lv_pct(100));
+    bbx_theme_prepare_keyboard(layer_keyboard);
+    apply_layer(layer_keyboard, layer);
+    return layer_keyboard;
+}
+
+
+/**
+ * Public functions
+ */
+
+int bb_keyboard_height_denominator(lv_coord_t width, lv_coord_t height) {
+    return (height > width) ? 3 : 2;
+}
+
+lv_obj_t *bb_keyboard_create(lv_obj_t *parent, const char *layout_name, bb_keyboard_key_cb cb) {
+    key_cb = cb;
+
+    /* Widgets of a previous keyboard were deleted along with their parent */
+    free(layer_keyboards);
+    layer_keyboards = NULL;
+    active_keyboard = NULL;
+    popovers = false;
+
+    lv_obj_t *keyboard = lv_obj_create(parent);
+    lv_obj_remove_style_all(keyboard);
+    lv_obj_remove_flag(keyboard, LV_OBJ_FLAG_CLICKABLE);
+    lv_obj_remove_flag(keyboard, LV_OBJ_FLAG_SCROLLABLE);
+    lv_obj_set_pos(keyboard, 0, 0);
+    lv_obj_set_size(keyboard, lv_pct(100), lv_pct(100));
+
+    /* Apply the requested layout and fall back to the built-in default if it can't be loaded */
+    if (!bb_keyboard_switch_layout(keyboard, layout_name)) {
+        bb_keyboard_switch_layout(keyboard, bb_layout_default_name);
+    }
+
+    return keyboard;
+}
+
+bool bb_keyboard_switch_layout(lv_obj_t *keyboard, const char *layout_name) {
+    if (active_keyboard) {
+        release_modifiers(active_keyboard);
+    }
+
+    if (!bb_layout_switch(layout_name)) {
+        return false;
+    }
+
+    /* The widgets of the previous layout are rebuilt lazily for the new one */
+    lv_obj_clean(keyboard);
+    free(layer_keyboards);
+    active_keyboard = NULL;
+
+    layer_keyboards = calloc(bb_layout_get_current()->num_layers, sizeof(lv_obj_t *));
+    if (!layer_keyboards) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for layout %s", layout_name);
+        return false;
+    }
+
+    return bb_keyboard_set_layer(keyboard, 0);
+}
+
+bool bb_keyboard_set_layer(lv_obj_t *keyboard, int index) {
+    if (!layer_keyboards || !bb_layout_prepare_layer(index)) {
+        return false;
+    }
+
+    /* Modifiers have to be released while the layout still reports the modifier indexes of the active layer.
+     * Otherwise, their key up events would never be sent and the modifiers would stay pressed. */
+    if (active_keyboard) {
+        release_modifiers(active_keyboard);
+    }
+
+    if (!bb_layout_set_layer(index)) {
+        return false;
+    }
+
+    if (!layer_keyboards[index]) {
+        layer_keyboards[index] = create_layer_keyboard(keyboard, &bb_layout_get_current()->layers[index]);
+    }
+
+    if (layer_keyboards[index] == active_keyboard) {
+        return true;
+    }
+
+    if (active_keyboard) {
+        lv_buttonmatrix_set_selected_button(active_keyboard, LV_BUTTONMATRIX_BUTTON_NONE);
+        lv_obj_add_flag(active_keyboard, LV_OBJ_FLAG_HIDDEN);
+    }
+    lv_obj_remove_flag(layer_keyboards[index], LV_OBJ_FLAG_HIDDEN);
+    active_keyboard = layer_keyboards[index];
+
+    return true;
+}
+
+lv_obj_t *bb_keyboard_get_active_layer(lv_obj_t *keyboard) {
+    return active_keyboard;
+}
+
+void bb_keyboard_set_popovers(lv_obj_t *keyboard, bool enabled) {
+    popovers = enabled;
+
+    const bb_layout *layout = bb_layout_get_current();
+    for (int i = 0; layer_keyboards && i < layout->num_layers; ++i) {
+        if (layer_keyboards[i]) {
+            apply_layer(layer_keyboards[i], &layout->layers[i]);
+        }
+    }
+}
+
+void bb_keyboard_release_modifiers(lv_obj_t *keyboard) {
+    if (active_keyboard) {
+        release_modifiers(active_keyboard);
+    }
+}
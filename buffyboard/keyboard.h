@@ -0,0 +1,86 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_KEYBOARD_H
+#define BB_KEYBOARD_H
+
+#include "lvgl/lvgl.h"
+
+#include <stdbool.h>
+
+/**
+ * Callback for emitting key events.
+ *
+ * @param scancode the key's scancode
+ * @param pressed true for a key down event, false for a key up event
+ */
+typedef void (*bb_keyboard_key_cb)(int scancode, bool pressed);
+
+/**
+ * Compute the denominator of the keyboard height factor. The keyboard height is calculated
+ * by dividing the display height by the denominator.
+ *
+ * @param width display width
+ * @param height display height
+ * @return denominator
+ */
+int bb_keyboard_height_denominator(lv_coord_t width, lv_coord_t height);
+
+/**
+ * Create a keyboard filling its parent and apply a layout. Each layer of the layout gets its own keyboard widget,
+ * styled with the current theme, which is built the first time the layer is shown and then kept. Switching layers
+ * only hides one widget and shows another. Only one keyboard may exist at a time.
+ *
+ * @param parent parent object
+ * @param layout_name short name of the layout to apply, falls back to the default layout if it can't be loaded
+ * @param key_cb callback to invoke for key events triggered through the keyboard
+ * @return container holding the keyboard widgets
+ */
+lv_obj_t *bb_keyboard_create(lv_obj_t *parent, const char *layout_name, bb_keyboard_key_cb key_cb);
+
+/**
+ * Release any pressed modifiers, switch to another layout and show its first layer. The widgets of the previous
+ * layout are deleted.
+ *
+ * @param keyboard container returned by bb_keyboard_create
+ * @param layout_name short name of the layout
+ * @return true if the layout was applied, false if the previous layout was kept
+ */
+bool bb_keyboard_switch_layout(lv_obj_t *keyboard, const char *layout_name);
+
+/**
+ * Show a layer of the current layout. Checked modifiers of the active layer are released first.
+ *
+ * @param keyboard container returned by bb_keyboard_create
+ * @param index index of the layer
+ * @return true if the layer is shown, false otherwise
+ */
+bool bb_keyboard_set_layer(lv_obj_t *keyboard, int index);
+
+/**
+ * Get the keyboard widget of the layer that is currently shown.
+ *
+ * @param keyboard container returned by bb_keyboard_create
+ * @return keyboard widget
+ */
+lv_obj_t *bb_keyboard_get_active_layer(lv_obj_t *keyboard);
+
+/**
+ * Enable or disable popovers on all layers.
+ *
+ * @param keyboard container returned by bb_keyboard_create
+ * @param enabled true to show popovers when keys are pressed
+ */
+void bb_keyboard_set_popovers(lv_obj_t *keyboard, bool enabled);
+
+/**
+ * Release any previously pressed modifier keys.
+ *
+ * @param keyboard container returned by bb_keyboard_create
+ */
+void bb_keyboard_release_modifiers(lv_obj_t *keyboard);
+
+#endif /* BB_KEYBOARD_H */
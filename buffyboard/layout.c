@@ -0,0 +1,803 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "layout.h"
+
+#include "layout_tables.h"
+
+#include "../shared/log.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * Defines
+ */
+
+/* Directory that compiled layout files are loaded from */
+#define LAYOUT_DIR "/usr/share/buffyboard/layouts"
+
+/* File name suffix of compiled layout files */
+#define FILE_SUFFIX ".bbl"
+
+/* Magic bytes at the start of compiled layout files */
+#define FILE_MAGIC "BBL1"
+
+/* Version of the compiled layout format */
+#define FILE_VERSION 2
+
+
+/**
+ * Static types
+ */
+
+/* Header of a compiled layout file. All offsets are in bytes from the start of the file and all numbers are
+ * stored in host byte order. */
+typedef struct {
+    /* FILE_MAGIC */
+    char magic[4];
+    /* FILE_VERSION */
+    uint32_t version;
+    /* Total size of the file */
+    uint32_t size;
+    /* Offset of the NUL-terminated layout name */
+    uint32_t name;
+    /* Offset of the NUL-terminated layout short name */
+    uint32_t short_name;
+    /* Number of layers */
+    uint32_t num_layers;
+    /* Offset of num_layers file_layer records */
+    uint32_t layers;
+    /* Number of unique scancodes used by the layout */
+    uint32_t num_scancodes;
+    /* Offset of num_scancodes uint16_t unique scancodes */
+    uint32_t scancodes;
+} file_header;
+
+/* Layer record in a compiled layout file. Arrays are 4-byte aligned. */
+typedef struct {
+    /* Number of keys */
+    uint32_t num_keys;
+    /* Number of key caps including row separators and the terminating empty string */
+    uint32_t num_keycaps;
+    /* Offset of num_keycaps uint32_t offsets of NUL-terminated key caps */
+    uint32_t keycaps;
+    /* Offset of num_keys uint32_t key attributes */
+    uint32_t attributes;
+    /* Offset of num_keys bb_layout_key records */
+    uint32_t keys;
+    /* Number of modifier keys */
+    uint32_t num_modifiers;
+    /* Offset of num_modifiers uint16_t button indexes of modifier keys */
+    uint32_t modifier_idxs;
+} file_layer;
+
+/* Layout mapped from a compiled file */
+typedef struct {
+    /* Layout referencing the mapped data */
+    bb_layout layout;
+    /* Mapped file */
+    const uint8_t *data;
+    /* Size of the mapped file */
+    size_t size;
+    /* Layers, with key caps and attributes only filled in once a layer is shown */
+    bb_layout_layer *layers;
+    /* Key cap pointers per layer, allocated once a layer is shown */
+    const char ***keycaps;
+    /* Key attributes per layer, allocated once a layer is shown */
+    lv_buttonmatrix_ctrl_t **attributes;
+} mapped_layout;
+
+/* Growable buffer for writing layout files */
+typedef struct {
+    /* Written data */
+    uint8_t *data;
+    /* Number of written bytes */
+    size_t size;
+    /* Number of allocated bytes */
+    size_t capacity;
+    /* Whether an allocation failed */
+    bool failed;
+} buffer;
+
+
+/**
+ * Static variables
+ */
+
+const char * const bb_layout_default_name = "terminal/us";
+
+static const bb_layout *current_layout = NULL;
+static int current_layer_index = 0;
+static mapped_layout *current_mapped = NULL;
+static mapped_layout *previous_mapped = NULL;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Build the path of a layout's compiled file.
+ *
+ * @param dir directory containing the file
+ * @param short_name short name of the layout
+ * @param path buffer for writing the path into
+ * @param size size of the buffer
+ */
+static void get_file_path(const char *dir, const char *short_name, char *path, size_t size);
+
+/**
+ * Check that an array lies within a mapped file and is suitably aligned.
+ *
+ * @param size size of the file
+ * @param offset offset of the array
+ * @param count number of elements
+ * @param elem_size size of each element
+ * @return true if the array is valid, false otherwise
+ */
+static bool is_valid_array(size_t size, uint32_t offset, uint32_t count, size_t elem_size);
+
+/**
+ * Check that a NUL-terminated string lies within a mapped file.
+ *
+ * @param data mapped file
+ * @param size size of the file
+ * @param offset offset of the string
+ * @return true if the string is valid, false otherwise
+ */
+static bool is_valid_string(const uint8_t *data, size_t size, uint32_t offset);
+
+/**
+ * Map a compiled layout file and check its header and layer records.
+ *
+ * @param path path of the file
+ * @param size pointer for writing the size of the mapping into
+ * @return mapped file or NULL on failure
+ */
+static const uint8_t *map_file(const char *path, size_t *size);
+
+/**
+ * Map a layout from its compiled file in the layout directory.
+ *
+ * @param short_name short name of the layout
+ * @return layout or NULL on failure
+ */
+static mapped_layout *load_file_layout(const char *short_name);
+
+/**
+ * Unmap a layout and free its memory.
+ *
+ * @param mapped layout to unmap
+ */
+static void unload_file_layout(mapped_layout *mapped);
+
+/**
+ * Fill in the key caps and attributes of a mapped layer and check its indexes, unless done already.
+ *
+ * @param mapped layout containing the layer
+ * @param index index of the layer
+ * @return true on success, false if the layer is invalid
+ */
+static bool prepare_layer(mapped_layout *mapped, int index);
+
+/**
+ * Append data to a buffer.
+ *
+ * @param buf buffer
+ * @param data data to append or NULL to append zeros
+ * @param size number of bytes to append
+ * @param alignment alignment of the appended data, must be a power of two
+ * @return offset of the appended data
+ */
+static uint32_t append_aligned(buffer *buf, const void *data, size_t size, size_t alignment);
+
+/**
+ * Append data to a buffer at the next 4-byte aligned position.
+ *
+ * @param buf buffer
+ * @param data data to append or NULL to append zeros
+ * @param size number of bytes to append
+ * @return offset of the appended data
+ */
+static uint32_t append(buffer *buf, const void *data, size_t size);
+
+/**
+ * Append a NUL-terminated string to a buffer.
+ *
+ * @param buf buffer
+ * @param str string to append
+ * @return offset of the appended string
+ */
+static uint32_t append_string(buffer *buf, const char *str);
+
+/**
+ * Compile a built-in layout into a file.
+ *
+ * @param layout layout to compile
+ * @param path path of the file to write
+ * @return true on success, false otherwise
+ */
+static bool export_layout(const bb_layout *layout, const char *path);
+
+
+/**
+ * Static functions
+ */
+
+static void get_file_path(const char *dir, const char *short_name, char *path, size_t size) {
+    /* Short names contain slashes (e.g. "terminal/us"), which can't appear in file names */
+    int len = snprintf(path, size, "%s/", dir);
+    for (const char *c = short_name; *c && len < (int)size - 1; ++c) {
+        path[len++] = (*c == '/') ? '-' : *c;
+    }
+    path[len] = '\0';
+    strncat(path, FILE_SUFFIX, size - len - 1);
+}
+
+static bool is_valid_array(size_t size, uint32_t offset, uint32_t count, size_t elem_size) {
+    return offset % 4 == 0 && offset <= size && count <= (size - offset) / elem_size;
+}
+
+static bool is_valid_string(const uint8_t *data, size_t size, uint32_t offset) {
+    return offset < size && memchr(data + offset, '\0', size - offset) != NULL;
+}
+
+static const uint8_t *map_file(const char *path, size_t *size) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return NULL;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(file_header) || st.st_size > UINT32_MAX) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Ignoring invalid layout file %s", path);
+        close(fd);
+        return NULL;
+    }
+
+    const uint8_t *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not map layout file %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    /* Only the fixed-size records are checked here. Each layer's contents are checked when it's first shown. */
+    const file_header *header = (const file_header *)data;
+    bool is_valid = memcmp(header->magic, FILE_MAGIC, sizeof(header->magic)) == 0
+        && header->version == FILE_VERSION
+        && header->size == st.st_size
+        && header->num_layers > 0
+        && is_valid_string(data, st.st_size, header->name)
+        && is_valid_string(data, st.st_size, header->short_name)
+        && is_valid_array(st.st_size, header->layers, header->num_layers, sizeof(file_layer))
+        && is_valid_array(st.st_size, header->scancodes, header->num_scancodes, sizeof(uint16_t));
+
+    for (uint32_t i = 0; is_valid && i < header->num_layers; ++i) {
+        const file_layer *layer = (const file_layer *)(data + header->layers) + i;
+        is_valid = layer->num_keycaps > layer->num_keys
+            && is_valid_array(st.st_size, layer->keycaps, layer->num_keycaps, sizeof(uint32_t))
+            && is_valid_array(st.st_size, layer->attributes, layer->num_keys, sizeof(uint32_t))
+            && is_valid_array(st.st_size, layer->keys, layer->num_keys, sizeof(bb_layout_key))
+            && is_valid_array(st.st_size, layer->modifier_idxs, layer->num_modifiers, sizeof(uint16_t));
+    }
+
+    if (!is_valid) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Ignoring invalid layout file %s", path);
+        munmap((void *)data, st.st_size);
+        return NULL;
+    }
+
+    *size = st.st_size;
+    return data;
+}
+
+static mapped_layout *load_file_layout(const char *short_name) {
+    char path[PATH_MAX];
+    get_file_path(LAYOUT_DIR, short_name, path, sizeof(path));
+
+    size_t size = 0;
+    const uint8_t *data = map_file(path, &size);
+    if (!data) {
+        return NULL;
+    }
+
+    const file_header *header = (const file_header *)data;
+    mapped_layout *mapped = calloc(1, sizeof(mapped_layout));
+    if (mapped) {
+        mapped->layers = calloc(header->num_layers, sizeof(bb_layout_layer));
+        mapped->keycaps = calloc(header->num_layers, sizeof(const char **));
+        mapped->attributes = calloc(header->num_layers, sizeof(lv_buttonmatrix_ctrl_t *));
+    }
+    if (!mapped || !mapped->layers || !mapped->keycaps || !mapped->attributes) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for layout %s", path);
+        if (mapped) {
+            free(mapped->layers);
+            free(mapped->keycaps);
+            free(mapped->attributes);
+            free(mapped);
+        }
+        munmap((void *)data, size);
+        return NULL;
+    }
+
+    /* Point straight into the mapping, the key records and modifier indexes can be used as they are */
+    const file_layer *layers = (const file_layer *)(data + header->layers);
+    for (uint32_t i = 0; i < header->num_layers; ++i) {
+        bb_layout_layer *layer = &mapped->layers[i];
+        layer->num_keys = layers[i].num_keys;
+        layer->keys = (const bb_layout_key *)(data + layers[i].keys);
+        layer->num_modifiers = layers[i].num_modifiers;
+        layer->modifier_idxs = (const uint16_t *)(data + layers[i].modifier_idxs);
+    }
+
+    mapped->data = data;
+    mapped->size = size;
+    mapped->layout.name = (const char *)(data + header->name);
+    mapped->layout.short_name = (const char *)(data + header->short_name);
+    mapped->layout.num_layers = header->num_layers;
+    mapped->layout.layers = mapped->layers;
+
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Mapped layout %s (%zu bytes) from %s", mapped->layout.name, size, path);
+    return mapped;
+}
+
+static void unload_file_layout(mapped_layout *mapped) {
+    for (int i = 0; i < mapped->layout.num_layers; ++i) {
+        free(mapped->keycaps[i]);
+        free(mapped->attributes[i]);
+    }
+    free(mapped->keycaps);
+    free(mapped->attributes);
+    free(mapped->layers);
+    munmap((void *)mapped->data, mapped->size);
+    free(mapped);
+}
+
+static bool prepare_layer(mapped_layout *mapped, int index) {
+    if (mapped->keycaps[index]) {
+        return true;
+    }
+
+    const file_header *header = (const file_header *)mapped->data;
+    const file_layer *src = (const file_layer *)(mapped->data + header->layers) + index;
+    bb_layout_layer *layer = &mapped->layers[index];
+
+    /* Check the key records once so that key presses can use them without further checks */
+    bool is_valid = true;
+    for (int i = 0; is_valid && i < layer->num_keys; ++i) {
+        const bb_layout_key *key = &layer->keys[i];
+        is_valid = key->num_scancodes <= BB_LAYOUT_MAX_KEY_SCANCODES
+            && (!(key->flags & BB_LAYOUT_KEY_SWITCHER) || key->dest_layer < mapped->layout.num_layers);
+    }
+    for (int i = 0; is_valid && i < layer->num_modifiers; ++i) {
+        is_valid = layer->modifier_idxs[i] < layer->num_keys
+            && (layer->keys[layer->modifier_idxs[i]].flags & BB_LAYOUT_KEY_MODIFIER);
+    }
+
+    /* LVGL needs pointers to the key caps and attributes of its own type, so these can't be used in place */
+    const uint32_t *keycap_offsets = (const uint32_t *)(mapped->data + src->keycaps);
+    for (uint32_t i = 0; is_valid && i < src->num_keycaps; ++i) {
+        is_valid = is_valid_string(mapped->data, mapped->size, keycap_offsets[i]);
+    }
+    is_valid = is_valid && mapped->data[keycap_offsets[src->num_keycaps - 1]] == '\0';
+
+    /* LVGL creates a button per key cap other than "\n" up to the first empty one and indexes the attributes and
+     * keys with it, so the key caps have to match the number of keys exactly */
+    int num_buttons = 0;
+    for (uint32_t i = 0; is_valid && i + 1 < src->num_keycaps; ++i) {
+        const char *keycap = (const char *)(mapped->data + keycap_offsets[i]);
+        is_valid = keycap[0] != '\0';
+        if (strcmp(keycap, "\n") != 0) {
+            ++num_buttons;
+        }
+    }
+    is_valid = is_valid && num_buttons == layer->num_keys;
+
+    if (!is_valid) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Layer %d of layout %s is invalid", index, mapped->layout.name);
+        return false;
+    }
+
+    const char **keycaps = malloc(src->num_keycaps * sizeof(const char *));
+    lv_buttonmatrix_ctrl_t *attributes = malloc(layer->num_keys * sizeof(lv_buttonmatrix_ctrl_t));
+    if (!keycaps || !attributes) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for layer %d of layout %s", index,
+            mapped->layout.name);
+        free(keycaps);
+        free(attributes);
+        return false;
+    }
+
+    for (uint32_t i = 0; i < src->num_keycaps; ++i) {
+        keycaps[i] = (const char *)(mapped->data + keycap_offsets[i]);
+    }
+    const uint32_t *attribute_values = (const uint32_t *)(mapped->data + src->attributes);
+    for (int i = 0; i < layer->num_keys; ++i) {
+        attributes[i] = attribute_values[i];
+    }
+
+    mapped->keycaps[index] = keycaps;
+    mapped->attributes[index] = attributes;
+    layer->keycaps = keycaps;
+    layer->attributes = attributes;
+    return true;
+}
+
+static uint32_t append_aligned(buffer *buf, const void *data, size_t size, size_t alignment) {
+    size_t offset = (buf->size + alignment - 1) & ~(alignment - 1);
+    if (offset + size > buf->capacity) {
+        size_t capacity = buf->capacity ? buf->capacity : 4096;
+        while (offset + size > capacity) {
+            capacity *= 2;
+        }
+        uint8_t *grown = realloc(buf->data, capacity);
+        if (!grown) {
+            buf->failed = true;
+            return 0;
+        }
+        buf->data = grown;
+        buf->capacity = capacity;
+    }
+
+    memset(buf->data + buf->size, 0, offset - buf->size);
+    if (data) {
+        memcpy(buf->data + offset, data, size);
+    } else {
+        memset(buf->data + offset, 0, size);
+    }
+    buf->size = offset + size;
+    return offset;
+}
+
+static uint32_t append(buffer *buf, const void *data, size_t size) {
+    return append_aligned(buf, data, size, 4);
+}
+
+static uint32_t append_string(buffer *buf, const char *str) {
+    /* Strings don't need to be aligned, so pack them tightly */
+    return append_aligned(buf, str, strlen(str) + 1, 1);
+}
+
+static bool export_layout(const bb_layout *layout, const char *path) {
+    buffer buf = { NULL, 0, 0, false };
+    file_header header;
+    memset(&header, 0, sizeof(header));
+    append(&buf, NULL, sizeof(file_header));
+    header.layers = append(&buf, NULL, layout->num_layers * sizeof(file_layer));
+
+    bool is_used[KEY_MAX + 1];
+    memset(is_used, 0, sizeof(is_used));
+
+    for (int i = 0; i < layout->num_layers; ++i) {
+        const bb_layout_layer *src = &layout->layers[i];
+        file_layer layer;
+        memset(&layer, 0, sizeof(layer));
+
+        /* Key caps are terminated by an empty string */
+        layer.num_keycaps = 1;
+        while (src->keycaps[layer.num_keycaps - 1][0] != '\0') {
+            ++layer.num_keycaps;
+        }
+
+        uint32_t *keycap_offsets = malloc(layer.num_keycaps * sizeof(uint32_t));
+        uint32_t *attributes = malloc(src->num_keys * sizeof(uint32_t));
+        if (!keycap_offsets || !attributes) {
+            free(keycap_offsets);
+            free(attributes);
+            free(buf.data);
+            bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for %s", path);
+            return false;
+        }
+        for (uint32_t j = 0; j < layer.num_keycaps; ++j) {
+            keycap_offsets[j] = append_string(&buf, src->keycaps[j]);
+        }
+        for (int j = 0; j < src->num_keys; ++j) {
+            attributes[j] = src->attributes[j];
+        }
+
+        layer.num_keys = src->num_keys;
+        layer.keycaps = append(&buf, keycap_offsets, layer.num_keycaps * sizeof(uint32_t));
+        layer.attributes = append(&buf, attributes, src->num_keys * sizeof(uint32_t));
+        layer.keys = append(&buf, src->keys, src->num_keys * sizeof(bb_layout_key));
+        layer.num_modifiers = src->num_modifiers;
+        layer.modifier_idxs = append(&buf, src->modifier_idxs, src->num_modifiers * sizeof(uint16_t));
+        free(keycap_offsets);
+        free(attributes);
+
+        for (int j = 0; j < src->num_keys; ++j) {
+            for (int k = 0; k < src->keys[j].num_scancodes; ++k) {
+                is_used[src->keys[j].scancodes[k]] = true;
+            }
+        }
+
+        if (!buf.failed) {
+            memcpy(buf.data + header.layers + i * sizeof(file_layer), &layer, sizeof(layer));
+        }
+    }
+
+    uint16_t scancodes[KEY_MAX + 1];
+    int num_scancodes = 0;
+    for (int i = 0; i <= KEY_MAX; ++i) {
+        if (is_used[i]) {
+            scancodes[num_scancodes++] = i;
+        }
+    }
+
+    memcpy(header.magic, FILE_MAGIC, sizeof(header.magic));
+    header.version = FILE_VERSION;
+    header.name = append_string(&buf, layout->name);
+    header.short_name = append_string(&buf, layout->short_name);
+    header.num_layers = layout->num_layers;
+    header.num_scancodes = num_scancodes;
+    header.scancodes = append(&buf, scancodes, num_scancodes * sizeof(uint16_t));
+    header.size = buf.size;
+
+    if (buf.failed) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for %s", path);
+        free(buf.data);
+        return false;
+    }
+    memcpy(buf.data, &header, sizeof(header));
+
+    /* Write to a temporary file and rename it so that a running instance never maps a half-written file */
+    char tmp_path[PATH_MAX + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+    FILE *file = fopen(tmp_path, "we");
+    bool success = file && fwrite(buf.data, 1, buf.size, file) == buf.size;
+    if (file && fclose(file) != 0) {
+        success = false;
+    }
+    if (!success || rename(tmp_path, path) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not write layout file %s", path);
+        unlink(tmp_path);
+        success = false;
+    }
+
+    free(buf.data);
+    return success;
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_layout_switch(const char *short_name) {
+    const bb_layout *layout = NULL;
+    mapped_layout *mapped = NULL;
+
+    for (int i = 0; i < bb_layout_num_builtin_layouts && !layout; ++i) {
+        if (strcmp(bb_layout_builtin_layouts[i].short_name, short_name) == 0) {
+            layout = &bb_layout_builtin_layouts[i];
+        }
+    }
+
+    mapped_layout *candidates[] = { current_mapped, previous_mapped };
+    for (int i = 0; i < 2 && !layout; ++i) {
+        if (candidates[i] && strcmp(candidates[i]->layout.short_name, short_name) == 0) {
+            mapped = candidates[i];
+            layout = &mapped->layout;
+        }
+    }
+
+    if (!layout) {
+        mapped = load_file_layout(short_name);
+        if (!mapped) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "Could not find layout %s", short_name);
+            return false;
+        }
+        layout = &mapped->layout;
+    }
+
+    if (mapped && !prepare_layer(mapped, 0)) {
+        if (mapped != current_mapped && mapped != previous_mapped) {
+            unload_file_layout(mapped);
+        }
+        return false;
+    }
+
+    /* Widgets showing the outgoing layout are only deleted after the switch, so its file stays mapped until the
+     * next one. Anything older than that is no longer referenced. */
+    mapped_layout *outgoing = (current_mapped != mapped) ? current_mapped : NULL;
+    if (previous_mapped && previous_mapped != mapped && previous_mapped != outgoing) {
+        unload_file_layout(previous_mapped);
+    }
+    previous_mapped = outgoing;
+
+    current_layout = layout;
+    current_mapped = mapped;
+    current_layer_index = 0;
+    return true;
+}
+
+bool bb_layout_set_layer(int index) {
+    if (!bb_layout_prepare_layer(index)) {
+        return false;
+    }
+
+    current_layer_index = index;
+    return true;
+}
+
+bool bb_layout_prepare_layer(int index) {
+    if (!current_layout || index < 0 || index >= current_layout->num_layers) {
+        return false;
+    }
+
+    return !current_mapped || prepare_layer(current_mapped, index);
+}
+
+int bb_layout_get_switcher_dest(uint16_t btn_id) {
+    if (!current_layout || btn_id >= current_layout->layers[current_layer_index].num_keys) {
+        return -1;
+    }
+
+    const bb_layout_key *key = &current_layout->layers[current_layer_index].keys[btn_id];
+    return (key->flags & BB_LAYOUT_KEY_SWITCHER) ? key->dest_layer : -1;
+}
+
+bool bb_layout_is_layer_switcher(uint16_t btn_id) {
+    return bb_layout_get_switcher_dest(btn_id) >= 0;
+}
+
+bool bb_layout_is_modifier(uint16_t btn_id) {
+    if (!current_layout || btn_id >= current_layout->layers[current_layer_index].num_keys) {
+        return false;
+    }
+
+    return current_layout->layers[current_layer_index].keys[btn_id].flags & BB_LAYOUT_KEY_MODIFIER;
+}
+
+const uint16_t *bb_layout_get_scancodes(uint16_t btn_id, int *num_scancodes) {
+    *num_scancodes = 0;
+    if (!current_layout || btn_id >= current_layout->layers[current_layer_index].num_keys) {
+        return NULL;
+    }
+
+    const bb_layout_key *key = &current_layout->layers[current_layer_index].keys[btn_id];
+    if (key->num_scancodes == 0) {
+        return NULL;
+    }
+
+    *num_scancodes = key->num_scancodes;
+    return key->scancodes;
+}
+
+const uint16_t *bb_layout_get_modifier_indexes(int *num_modifiers) {
+    *num_modifiers = 0;
+    if (!current_layout) {
+        return NULL;
+    }
+
+    const bb_layout_layer *layer = &current_layout->layers[current_layer_index];
+    *num_modifiers = layer->num_modifiers;
+    return layer->modifier_idxs;
+}
+
+const bb_layout *bb_layout_get_current(void) {
+    return current_layout;
+}
+
+int bb_layout_get_current_layer_index(void) {
+    return current_layer_index;
+}
+
+void bb_layout_describe_source(const char *short_name, char *source, size_t size) {
+    for (int i = 0; i < bb_layout_num_builtin_layouts; ++i) {
+        if (strcmp(bb_layout_builtin_layouts[i].short_name, short_name) == 0) {
+            snprintf(source, size, "builtin");
+            return;
+        }
+    }
+
+    char path[PATH_MAX];
+    get_file_path(LAYOUT_DIR, short_name, path, sizeof(path));
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        snprintf(source, size, "missing");
+        return;
+    }
+
+    snprintf(source, size, "file@%lld.%09ld/%lld", (long long)st.st_mtim.tv_sec, st.st_mtim.tv_nsec,
+        (long long)st.st_size);
+}
+
+bool bb_layout_collect_scancodes(int **scancodes, int *num_scancodes) {
+    bool is_used[KEY_MAX + 1];
+    memset(is_used, 0, sizeof(is_used));
+
+    for (int i = 0; i < bb_layout_num_builtin_scancodes; ++i) {
+        is_used[bb_layout_builtin_scancodes[i]] = true;
+    }
+
+    /* Layouts can be switched at runtime, so the device needs to cover all of them from the start */
+    DIR *dir = opendir(LAYOUT_DIR);
+    if (dir) {
+        struct dirent *entry;
+        while ((entry = readdir(dir)) != NULL) {
+            size_t len = strlen(entry->d_name);
+            if (len <= strlen(FILE_SUFFIX) || strcmp(entry->d_name + len - strlen(FILE_SUFFIX), FILE_SUFFIX) != 0) {
+                continue;
+            }
+
+            char path[PATH_MAX];
+            snprintf(path, sizeof(path), "%s/%s", LAYOUT_DIR, entry->d_name);
+            size_t size = 0;
+            const uint8_t *data = map_file(path, &size);
+            if (!data) {
+                continue;
+            }
+
+            const file_header *header = (const file_header *)data;
+            const uint16_t *file_scancodes = (const uint16_t *)(data + header->scancodes);
+            for (uint32_t i = 0; i < header->num_scancodes; ++i) {
+                if (file_scancodes[i] <= KEY_MAX) {
+                    is_used[file_scancodes[i]] = true;
+                }
+            }
+            munmap((void *)data, size);
+        }
+        closedir(dir);
+    }
+
+    int count = 0;
+    for (int i = 0; i <= KEY_MAX; ++i) {
+        count += is_used[i];
+    }
+
+    int *result = malloc(count * sizeof(int));
+    if (!result) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for scancodes");
+        return false;
+    }
+
+    count = 0;
+    for (int i = 0; i <= KEY_MAX; ++i) {
+        if (is_used[i]) {
+            result[count++] = i;
+        }
+    }
+
+    *scancodes = result;
+    *num_scancodes = count;
+    return true;
+}
+
+bool bb_layout_export(const char *dir) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not create %s: %s", dir, strerror(errno));
+        return false;
+    }
+
+    bool success = true;
+    for (int i = 0; i < bb_layout_num_builtin_layouts; ++i) {
+        char path[PATH_MAX];
+        get_file_path(dir, bb_layout_builtin_layouts[i].short_name, path, sizeof(path));
+        if (export_layout(&bb_layout_builtin_layouts[i], path)) {
+            bbx_log(BBX_LOG_LEVEL_VERBOSE, "Wrote %s", path);
+        } else {
+            success = false;
+        }
+    }
+
+    return success;
+}
@@ -0,0 +1,184 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_LAYOUT_H
+#define BB_LAYOUT_H
+
+#include "lvgl/lvgl.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Flag of keys that are modifiers */
+#define BB_LAYOUT_KEY_MODIFIER 0x01
+/* Flag of keys that switch to another layer */
+#define BB_LAYOUT_KEY_SWITCHER 0x02
+
+/* Maximum number of scancodes emitted by a single key */
+#define BB_LAYOUT_MAX_KEY_SCANCODES 3
+
+/**
+ * Everything needed to handle a key press, packed so that each query is a single indexed load
+ */
+typedef struct {
+    /* Scancodes to emit in order */
+    uint16_t scancodes[BB_LAYOUT_MAX_KEY_SCANCODES];
+    /* Number of scancodes */
+    uint8_t num_scancodes;
+    /* Combination of BB_LAYOUT_KEY_* flags */
+    uint8_t flags;
+    /* Index of the layer to switch to if the key is a layer switcher */
+    uint8_t dest_layer;
+    /* Unused, keeps the size even */
+    uint8_t reserved;
+} bb_layout_key;
+
+/**
+ * Keyboard layer
+ */
+typedef struct {
+    /* Number of keys */
+    int num_keys;
+    /* Key caps including row separators, terminated by an empty string */
+    const char * const *keycaps;
+    /* Key attributes */
+    const lv_buttonmatrix_ctrl_t *attributes;
+    /* Key records */
+    const bb_layout_key *keys;
+    /* Number of modifier keys */
+    int num_modifiers;
+    /* Button indexes of modifier keys */
+    const uint16_t *modifier_idxs;
+} bb_layout_layer;
+
+/**
+ * Keyboard layout
+ */
+typedef struct {
+    /* Layout name */
+    const char *name;
+    /* Layout short name */
+    const char *short_name;
+    /* Total number of layers */
+    int num_layers;
+    /* Layers array */
+    const bb_layout_layer *layers;
+} bb_layout;
+
+/* Short name of the layout that is used unless configured otherwise */
+extern const char * const bb_layout_default_name;
+
+/**
+ * Make a layout current and select its first layer. Built-in layouts are looked up first. Otherwise, the layout
+ * is mapped from its compiled file in the layout directory. The outgoing layout's file stays mapped until the
+ * next switch so that widgets showing it can be deleted afterwards.
+ *
+ * @param short_name short name of the layout (e.g. "terminal/us")
+ * @return true if the layout was found and its first layer is valid, false otherwise
+ */
+bool bb_layout_switch(const char *short_name);
+
+/**
+ * Select a layer of the current layout, unpacking its key caps and attributes if needed.
+ *
+ * @param index index of the layer
+ * @return true if the layer was selected, false if it doesn't exist or is invalid
+ */
+bool bb_layout_set_layer(int index);
+
+/**
+ * Unpack the key caps and attributes of a layer of the current layout without selecting it.
+ *
+ * @param index index of the layer
+ * @return true if the layer can be used, false if it doesn't exist or is invalid
+ */
+bool bb_layout_prepare_layer(int index);
+
+/**
+ * Get the layer that a key on the current layer switches to.
+ *
+ * @param btn_id button index
+ * @return index of the destination layer or -1 if the key isn't a layer switcher
+ */
+int bb_layout_get_switcher_dest(uint16_t btn_id);
+
+/**
+ * Check whether a key on the current layer switches layers.
+ *
+ * @param btn_id button index
+ * @return true if the key is a layer switcher, false otherwise
+ */
+bool bb_layout_is_layer_switcher(uint16_t btn_id);
+
+/**
+ * Check whether a key on the current layer is a modifier.
+ *
+ * @param btn_id button index
+ * @return true if the key is a modifier, false otherwise
+ */
+bool bb_layout_is_modifier(uint16_t btn_id);
+
+/**
+ * Get the scancodes that a key on the current layer emits.
+ *
+ * @param btn_id button index
+ * @param num_scancodes pointer for writing the number of scancodes into
+ * @return scancodes or NULL if there are none
+ */
+const uint16_t *bb_layout_get_scancodes(uint16_t btn_id, int *num_scancodes);
+
+/**
+ * Get the button indexes of all modifier keys on the current layer.
+ *
+ * @param num_modifiers pointer for writing the number of modifiers into
+ * @return button indexes
+ */
+const uint16_t *bb_layout_get_modifier_indexes(int *num_modifiers);
+
+/**
+ * Get the current layout.
+ *
+ * @return layout or NULL if none was applied yet
+ */
+const bb_layout *bb_layout_get_current(void);
+
+/**
+ * Get the index of the current layer within the current layout.
+ *
+ * @return layer index
+ */
+int bb_layout_get_current_layer_index(void);
+
+/**
+ * Describe where a layout would be loaded from so that cached data derived from it can be invalidated when
+ * its layout file changes. Layout files are identified by their modification time and size.
+ *
+ * @param short_name short name of the layout (e.g. "terminal/us")
+ * @param source buffer for writing the description into
+ * @param size size of the buffer
+ */
+void bb_layout_describe_source(const char *short_name, char *source, size_t size);
+
+/**
+ * Collect the scancodes of all built-in layouts and of all layout files. Files are only mapped while they're
+ * being read. Safe to call from any thread.
+ *
+ * @param scancodes pointer for writing a newly allocated, sorted array of unique scancodes into
+ * @param num_scancodes pointer for writing the number of scancodes into
+ * @return true on success, false otherwise
+ */
+bool bb_layout_collect_scancodes(int **scancodes, int *num_scancodes);
+
+/**
+ * Compile all built-in layouts into layout files.
+ *
+ * @param dir directory to write the files into
+ * @return true on success, false otherwise
+ */
+bool bb_layout_export(const char *dir);
+
+#endif /* BB_LAYOUT_H */
@@ -0,0 +1,240 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+/* Build-time tool that packs the layouts generated by squeek2lvgl into the per-key tables used by layout.c */
+
+#include "layout.h"
+#include "sq2lv_layouts.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <linux/input.h>
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Write a string as a C string literal.
+ *
+ * @param file output file
+ * @param str string to write
+ */
+static void write_string(FILE *file, const char *str);
+
+/**
+ * Check a layer and write its tables.
+ *
+ * @param file output file
+ * @param layout layout containing the layer
+ * @param l index of the layout
+ * @param index index of the layer
+ * @param is_used array for marking the layer's scancodes in
+ * @return true on success, false if the layer can't be packed
+ */
+static bool write_layer(FILE *file, const sq2lv_layout_t *layout, int l, int index, bool *is_used);
+
+
+/**
+ * Static functions
+ */
+
+static void write_string(FILE *file, const char *str) {
+    fputc('"', file);
+    for (const unsigned char *c = (const unsigned char *)str; *c; ++c) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(file, "\\%c", *c);
+        } else if (*c == '\n') {
+            fprintf(file, "\\n");
+        } else if (*c < 0x20 || *c >= 0x7f) {
+            /* Octal escapes end after three digits, unlike hex escapes, so following characters are safe */
+            fprintf(file, "\\%03o", *c);
+        } else {
+            fputc(*c, file);
+        }
+    }
+    fputc('"', file);
+}
+
+static bool write_layer(FILE *file, const sq2lv_layout_t *layout, int l, int index, bool *is_used) {
+    const sq2lv_layer_t *layer = &layout->layers[index];
+    if (layer->num_keys <= 0 || layer->num_keys > UINT16_MAX) {
+        fprintf(stderr, "Layer %d of layout %s has an invalid number of keys\n", index, layout->short_name);
+        return false;
+    }
+
+    fprintf(file, "static const char * const keycaps_%d_%d[] = {\n   ", l, index);
+    for (int i = 0; ; ++i) {
+        fputc(' ', file);
+        write_string(file, layer->keycaps[i]);
+        if (layer->keycaps[i][0] == '\0') {
+            break;
+        }
+        fprintf(file, ",%s", strcmp(layer->keycaps[i], "\n") == 0 ? "\n   " : "");
+    }
+    fprintf(file, "\n};\n\n");
+
+    /* Break the attributes into the same rows as the key caps */
+    fprintf(file, "static const lv_buttonmatrix_ctrl_t attributes_%d_%d[] = {\n   ", l, index);
+    for (int i = 0, key = 0; layer->keycaps[i][0] != '\0'; ++i) {
+        if (strcmp(layer->keycaps[i], "\n") == 0) {
+            fprintf(file, "\n   ");
+        } else if (key < layer->num_keys) {
+            fprintf(file, " 0x%04x,", (unsigned int)layer->attributes[key++]);
+        }
+    }
+    fprintf(file, "\n};\n\n");
+
+    fprintf(file, "static const bb_layout_key keys_%d_%d[] = {\n", l, index);
+    for (int i = 0; i < layer->num_keys; ++i) {
+        bb_layout_key key;
+        memset(&key, 0, sizeof(key));
+
+        /* Keys without scancodes have an index of -1 */
+        int num_scancodes = layer->scancode_nums[i];
+        if (num_scancodes > BB_LAYOUT_MAX_KEY_SCANCODES) {
+            fprintf(stderr, "Key %d on layer %d of layout %s has more than %d scancodes\n", i, index,
+                layout->short_name, BB_LAYOUT_MAX_KEY_SCANCODES);
+            return false;
+        }
+        for (int j = 0; j < num_scancodes; ++j) {
+            int scancode = layer->scancodes[layer->scancode_idxs[i] + j];
+            if (scancode < 0 || scancode > KEY_MAX) {
+                fprintf(stderr, "Key %d on layer %d of layout %s has an invalid scancode\n", i, index,
+                    layout->short_name);
+                return false;
+            }
+            key.scancodes[key.num_scancodes++] = scancode;
+            is_used[scancode] = true;
+        }
+
+        for (int j = 0; j < layer->num_modifiers; ++j) {
+            if (layer->modifier_idxs[j] == i) {
+                key.flags |= BB_LAYOUT_KEY_MODIFIER;
+            }
+        }
+        for (int j = 0; j < layer->num_switchers; ++j) {
+            if (layer->switcher_idxs[j] != i) {
+                continue;
+            }
+            if (layer->switcher_dests[j] < 0 || layer->switcher_dests[j] >= layout->num_layers
+                    || layer->switcher_dests[j] > UINT8_MAX) {
+                fprintf(stderr, "Key %d on layer %d of layout %s switches to an invalid layer\n", i, index,
+                    layout->short_name);
+                return false;
+            }
+            key.flags |= BB_LAYOUT_KEY_SWITCHER;
+            key.dest_layer = layer->switcher_dests[j];
+        }
+
+        fprintf(file, "    { { %u, %u, %u }, %u, 0x%02x, %u, 0 },\n", key.scancodes[0], key.scancodes[1],
+            key.scancodes[2], key.num_scancodes, key.flags, key.dest_layer);
+    }
+    fprintf(file, "};\n\n");
+
+    /* C doesn't allow empty arrays, so layers without modifiers refer to NULL instead */
+    if (layer->num_modifiers > 0) {
+        fprintf(file, "static const uint16_t modifier_idxs_%d_%d[] = {", l, index);
+        for (int i = 0; i < layer->num_modifiers; ++i) {
+            if (layer->modifier_idxs[i] < 0 || layer->modifier_idxs[i] >= layer->num_keys) {
+                fprintf(stderr, "Layer %d of layout %s has an invalid modifier\n", index, layout->short_name);
+                return false;
+            }
+            fprintf(file, "%s %d", i > 0 ? "," : "", layer->modifier_idxs[i]);
+        }
+        fprintf(file, " };\n\n");
+    }
+
+    return true;
+}
+
+
+/**
+ * Main
+ */
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s OUTPUT\n", argv[0]);
+        return 1;
+    }
+
+    FILE *file = fopen(argv[1], "w");
+    if (!file) {
+        fprintf(stderr, "Could not open %s for writing\n", argv[1]);
+        return 1;
+    }
+
+    fprintf(file, "/**\n * Auto-generated with layout_compiler from sq2lv_layouts.c\n **/\n\n");
+    fprintf(file, "#include \"layout_tables.h\"\n\n");
+
+    static bool is_used[KEY_MAX + 1];
+    bool success = true;
+
+    for (int l = 0; l < sq2lv_num_layouts && success; ++l) {
+        const sq2lv_layout_t *layout = &sq2lv_layouts[l];
+        for (int i = 0; i < layout->num_layers && success; ++i) {
+            success = write_layer(file, layout, l, i, is_used);
+        }
+        if (!success) {
+            break;
+        }
+
+        fprintf(file, "static const bb_layout_layer layers_%d[] = {\n", l);
+        for (int i = 0; i < layout->num_layers; ++i) {
+            fprintf(file, "    { %d, keycaps_%d_%d, attributes_%d_%d, keys_%d_%d, %d, ", layout->layers[i].num_keys,
+                l, i, l, i, l, i, layout->layers[i].num_modifiers);
+            if (layout->layers[i].num_modifiers > 0) {
+                fprintf(file, "modifier_idxs_%d_%d },\n", l, i);
+            } else {
+                fprintf(file, "NULL },\n");
+            }
+        }
+        fprintf(file, "};\n\n");
+    }
+
+    if (success) {
+        fprintf(file, "const int bb_layout_num_builtin_layouts = %d;\n\n", sq2lv_num_layouts);
+        fprintf(file, "const bb_layout bb_layout_builtin_layouts[] = {\n");
+        for (int l = 0; l < sq2lv_num_layouts; ++l) {
+            fprintf(file, "    { ");
+            write_string(file, sq2lv_layouts[l].name);
+            fprintf(file, ", ");
+            write_string(file, sq2lv_layouts[l].short_name);
+            fprintf(file, ", %d, layers_%d },\n", sq2lv_layouts[l].num_layers, l);
+        }
+        fprintf(file, "};\n\n");
+
+        int num_scancodes = 0;
+        fprintf(file, "const uint16_t bb_layout_builtin_scancodes[] = {\n");
+        for (int i = 0; i <= KEY_MAX; ++i) {
+            if (is_used[i]) {
+                fprintf(file, "    %d,\n", i);
+                ++num_scancodes;
+            }
+        }
+        /* Keep the array non-empty even if no layout emits any scancodes */
+        if (num_scancodes == 0) {
+            fprintf(file, "    0\n");
+        }
+        fprintf(file, "};\n\n");
+        fprintf(file, "const int bb_layout_num_builtin_scancodes = %d;\n", num_scancodes);
+    }
+
+    if (fclose(file) != 0) {
+        fprintf(stderr, "Could not write %s\n", argv[1]);
+        success = false;
+    }
+    if (!success) {
+        remove(argv[1]);
+        return 1;
+    }
+
+    return 0;
+}
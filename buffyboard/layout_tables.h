@@ -0,0 +1,28 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_LAYOUT_TABLES_H
+#define BB_LAYOUT_TABLES_H
+
+#include "layout.h"
+
+#include <stdint.h>
+
+/* Tables of the built-in layouts, generated by layout_compiler.c at build time */
+
+/* Number of built-in layouts */
+extern const int bb_layout_num_builtin_layouts;
+
+/* Built-in layouts */
+extern const bb_layout bb_layout_builtin_layouts[];
+
+/* Number of unique scancodes across all built-in layouts */
+extern const int bb_layout_num_builtin_scancodes;
+
+/* Sorted unique scancodes across all built-in layouts */
+extern const uint16_t bb_layout_builtin_scancodes[];
+
+#endif /* BB_LAYOUT_TABLES_H */
@@ -7,8 +7,21 @@
 #include "buffyboard.h"
 #include "command_line.h"
 #include "config.h"
-#include "sq2lv_layouts.h"
+#include "config_watch.h"
+#include "control.h"
+#include "diagnostics.h"
+#include "evdev_touchscreen.h"
+#include "hardware_keyboard.h"
+#include "key_injection.h"
+#include "keyboard.h"
+#include "layout.h"
+#include "main_loop.h"
+#include "performance.h"
+#include "snapshot.h"
+#include "startup_trace.h"
+#include "stats.h"
 #include "terminal.h"
+#include "trace.h"
 #include "uinput_device.h"
 
 #include "lvgl/lvgl.h"
@@ -17,14 +30,16 @@
 #include "../shared/log.h"
 #include "../shared/theme.h"
 #include "../shared/themes.h"
-#include "../squeek2lvgl/sq2lv.h"
 
 #include <limits.h>
+#include <pthread.h>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
+#include <sys/signalfd.h>
 #include <sys/time.h>
 
 
@@ -37,6 +52,16 @@ bb_config_opts conf_opts;
 
 static bool resize_terminals = false;
 static lv_obj_t *keyboard = NULL;
+static bool is_hidden = false;
+
+static bool uinput_device_ready = false;
+static int terminal_total_height = 0;
+static int terminal_occupied_height = 0;
+
+/* Area covered by the display in physical (unrotated) framebuffer coordinates */
+static lv_area_t display_area;
+/* True if input devices are connected through shared/indev rather than the evdev touchscreen */
+static bool is_libinput_connected = false;
 
 
 /**
@@ -44,134 +69,472 @@ static lv_obj_t *keyboard = NULL;
  */
 
 /**
- * Compute the denominator of the keyboard height factor. The keyboard height is calculated
- * by dividing the display height by the denominator.
+ * Parse all configuration files in the documented order.
  *
- * @param width display width
- * @param height display height
- * @return denominator
+ * @param opts pointer for writing the parsed options into
+ */
+static void load_config(bb_config_opts *opts);
+
+/**
+ * Re-parse the configuration files and apply changed options where possible.
  */
-static int keyboard_height_denominator(lv_coord_t width, lv_coord_t height);
+static void config_changed_cb(void);
 
 /**
- * Handle termination signals sent to the process.
+ * Thread function for creating the uinput device while LVGL is being initialised.
  *
- * @param signum the signal's number
+ * @param data unused
+ * @return NULL
  */
-static void sigaction_handler(int signum);
+static void *uinput_device_worker(void *data);
 
 /**
- * Callback for the terminal resizing timer.
+ * Thread function for shrinking terminals while the keyboard is being built.
  *
- * @param timer the timer object
+ * @param data unused
+ * @return NULL
  */
-static void terminal_resize_timer_cb(lv_timer_t *timer);
+static void *terminal_worker(void *data);
 
 /**
- * Handle LV_EVENT_VALUE_CHANGED events from the keyboard widget.
- * 
+ * Run a function on a new thread or, if that fails, on the current one.
+ *
+ * @param thread pointer for writing the thread handle into
+ * @param worker function to run
+ * @return true if a thread was started and needs to be joined, false otherwise
+ */
+static bool run_in_background(pthread_t *thread, void *(*worker)(void *));
+
+/**
+ * Compute the area covered by a display in physical (unrotated) framebuffer coordinates.
+ *
+ * @param disp display
+ * @param offset_x horizontal offset of the display in rotated coordinates
+ * @param offset_y vertical offset of the display in rotated coordinates
+ * @param area pointer for writing the area into
+ */
+static void get_physical_display_area(lv_display_t *disp, int32_t offset_x, int32_t offset_y, lv_area_t *area);
+
+/**
+ * Connect input devices through the configured backend, falling back to libinput if no touchscreen can be
+ * found via evdev.
+ *
+ * @param opts input options
+ */
+static void connect_input_devices(const bb_config_opts_input *opts);
+
+/**
+ * Disconnect all input devices connected by connect_input_devices.
+ */
+static void disconnect_input_devices(void);
+
+/**
+ * Hide or show the keyboard. While hidden, terminals are reset to their full height and nothing is
+ * rendered. The keyboard's objects are kept alive so that showing it again doesn't require rebuilding them.
+ *
+ * @param hidden true to hide, false to show
+ */
+static void set_keyboard_hidden(bool hidden);
+
+/**
+ * Handle LV_EVENT_PRESSED events on the screen. Only ever triggered while the keyboard is hidden.
+ *
  * @param event the event object
  */
-static void keyboard_value_changed_cb(lv_event_t *event);
+static void screen_pressed_cb(lv_event_t *event);
 
 /**
- * Emit key down and up events for a key.
+ * Hide the keyboard while a hardware keyboard is connected and show it again once the last one is removed.
  *
- * @param btn_id button index corresponding to the key
- * @param key_down true if a key down event should be emitted
- * @param key_up true if a key up event should be emitted
+ * @param connected true if a hardware keyboard is connected
  */
-static void emit_key_events(uint16_t btn_id, bool key_down, bool key_up);
+static void hardware_keyboard_cb(bool connected);
 
 /**
- * Release any previously pressed modifier keys.
+ * Handle signals sent to the process. Signals are delivered through a signalfd and handled
+ * on the main loop so that terminal resets don't race with other threads.
+ *
+ * @param fd signalfd file descriptor
+ * @param user_data unused
  */
-static void pop_checked_modifier_keys(void);
+static void signal_cb(int fd, void *user_data);
 
+/**
+ * Run a command received on the control socket.
+ *
+ * @param command name of the command
+ * @param arg argument of the command, empty if there is none
+ * @param reply buffer for writing a reply or error message into
+ * @param reply_size size of the reply buffer
+ * @return true if the command succeeded, false otherwise
+ */
+static bool control_cb(const char *command, const char *arg, char *reply, size_t reply_size);
+
+/**
+ * Callback for the terminal resizing timer.
+ *
+ * @param timer the timer object
+ */
+static void terminal_resize_timer_cb(lv_timer_t *timer);
+
+/**
+ * Emit a key event through the uinput device.
+ *
+ * @param scancode the key's scancode
+ * @param pressed true for a key down event, false for a key up event
+ */
+static void emit_key_cb(int scancode, bool pressed);
 
 /**
  * Static functions
  */
 
-static int keyboard_height_denominator(lv_coord_t width, lv_coord_t height) {
-    return (height > width) ? 3 : 2;
+static void load_config(bb_config_opts *opts) {
+    bb_config_init_opts(opts);
+    bb_config_parse_file("/usr/share/buffyboard/buffyboard.conf", opts);
+    bb_config_parse_directory("/usr/share/buffyboard/buffyboard.conf.d", opts);
+    bb_config_parse_file("/etc/buffyboard.conf", opts);
+    bb_config_parse_directory("/etc/buffyboard.conf.d", opts);
+    bb_config_parse_files(cli_opts.config_files, cli_opts.num_config_files, opts);
 }
 
-static void sigaction_handler(int signum) {
-    if (resize_terminals) {
-        bb_terminal_reset_all();
+static void config_changed_cb(void) {
+    bb_config_opts opts;
+    load_config(&opts);
+
+    if (opts.theme.default_id != conf_opts.theme.default_id) {
+        bbx_log(BBX_LOG_LEVEL_VERBOSE, "Applying changed theme");
+        bbx_theme_apply(bbx_themes_themes[opts.theme.default_id]);
     }
-    exit(0);
+
+    if (strcmp(opts.layout.default_name, conf_opts.layout.default_name) != 0) {
+        if (bb_keyboard_switch_layout(keyboard, opts.layout.default_name)) {
+            bbx_log(BBX_LOG_LEVEL_VERBOSE, "Applied changed layout %s", opts.layout.default_name);
+        } else {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "Keeping layout %s", conf_opts.layout.default_name);
+            strcpy(opts.layout.default_name, conf_opts.layout.default_name);
+        }
+    }
+
+    if (opts.input.backend != conf_opts.input.backend
+            || opts.input.pointer != conf_opts.input.pointer
+            || opts.input.touchscreen != conf_opts.input.touchscreen) {
+        /* Only the input devices are replaced, the uinput device and the display stay as they are */
+        bbx_log(BBX_LOG_LEVEL_VERBOSE, "Reconnecting input devices");
+        disconnect_input_devices();
+        connect_input_devices(&opts.input);
+    }
+
+    if (memcmp(&opts.performance, &conf_opts.performance, sizeof(opts.performance)) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Changes to performance options only take effect after a restart");
+        opts.performance = conf_opts.performance;
+    }
+
+    if (opts.input.hide_on_hardware_keyboard != conf_opts.input.hide_on_hardware_keyboard) {
+        if (opts.input.hide_on_hardware_keyboard) {
+            bb_hardware_keyboard_monitor_init(hardware_keyboard_cb);
+        } else {
+            bb_hardware_keyboard_monitor_stop();
+        }
+    }
+
+    if (opts.terminal.eager_resize != conf_opts.terminal.eager_resize && resize_terminals) {
+        if (!opts.terminal.eager_resize) {
+            bb_terminal_stop_eager_resize();
+        } else if (!is_hidden) {
+            bb_terminal_start_eager_resize();
+        }
+    }
+
+    if (opts.quirks.fbdev_force_refresh != conf_opts.quirks.fbdev_force_refresh) {
+        lv_linux_fbdev_set_force_refresh(lv_display_get_default(), opts.quirks.fbdev_force_refresh);
+    }
+
+    conf_opts = opts;
 }
 
-static void terminal_resize_timer_cb(lv_timer_t *timer) {
+static void *uinput_device_worker(void *data) {
+    int phase = bb_startup_trace_begin("uinput device");
+    /* Cover the scancodes of all layouts so that switching layouts later doesn't need a new device */
+    int *scancodes = NULL;
+    int num_scancodes = 0;
+    if (bb_layout_collect_scancodes(&scancodes, &num_scancodes)) {
+        uinput_device_ready = bb_uinput_device_init(scancodes, num_scancodes);
+        free(scancodes);
+    }
+    bb_startup_trace_end(phase);
+    return NULL;
+}
+
+static void *terminal_worker(void *data) {
+    int phase = bb_startup_trace_begin("terminal resize");
+    resize_terminals = bb_terminal_init(terminal_total_height, terminal_occupied_height);
     if (resize_terminals) {
+        /* Resize current terminal */
         bb_terminal_shrink_current();
+
+        /* Resize all other terminals in the background if requested */
+        if (conf_opts.terminal.eager_resize) {
+            bb_terminal_start_eager_resize();
+        }
+    }
+    bb_startup_trace_end(phase);
+    return NULL;
+}
+
+static bool run_in_background(pthread_t *thread, void *(*worker)(void *)) {
+    if (pthread_create(thread, NULL, worker, NULL) == 0) {
+        return true;
+    }
+    worker(NULL);
+    return false;
+}
+
+static void get_physical_display_area(lv_display_t *disp, int32_t offset_x, int32_t offset_y, lv_area_t *area) {
+    int32_t width = lv_display_get_physical_horizontal_resolution(disp);
+    int32_t height = lv_display_get_physical_vertical_resolution(disp);
+    int32_t x1 = offset_x;
+    int32_t y1 = offset_y;
+    int32_t x2 = offset_x + lv_display_get_horizontal_resolution(disp) - 1;
+    int32_t y2 = offset_y + lv_display_get_vertical_resolution(disp) - 1;
+
+    /* Invert the rotation that LVGL applies to input device coordinates */
+    switch (lv_display_get_rotation(disp)) {
+        case LV_DISPLAY_ROTATION_0:
+            lv_area_set(area, x1, y1, x2, y2);
+            break;
+        case LV_DISPLAY_ROTATION_90:
+            lv_area_set(area, y1, height - 1 - x2, y2, height - 1 - x1);
+            break;
+        case LV_DISPLAY_ROTATION_180:
+            lv_area_set(area, width - 1 - x2, height - 1 - y2, width - 1 - x1, height - 1 - y1);
+            break;
+        case LV_DISPLAY_ROTATION_270:
+            lv_area_set(area, width - 1 - y2, x1, width - 1 - y1, x2);
+            break;
+    }
+}
+
+static void connect_input_devices(const bb_config_opts_input *opts) {
+    bool use_libinput = (opts->backend == BB_CONFIG_INPUT_BACKEND_LIBINPUT);
+    if (!use_libinput && opts->touchscreen) {
+        if (!bb_evdev_touchscreen_init(lv_display_get_default(), &display_area)) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "Could not connect touchscreen via evdev, falling back to libinput");
+            use_libinput = true;
+        }
+    }
+    if (use_libinput) {
+        /* Start input device monitor and auto-connect available devices */
+        bbx_indev_start_monitor_and_autoconnect(false, opts->pointer, opts->touchscreen);
     }
+    is_libinput_connected = use_libinput;
 }
 
-static void keyboard_value_changed_cb(lv_event_t *event) {
-    lv_obj_t *kb = lv_event_get_target(event);
+static void disconnect_input_devices(void) {
+    bb_evdev_touchscreen_stop();
 
-    uint16_t btn_id = lv_buttonmatrix_get_selected_button(kb);
-    if (btn_id == LV_BUTTONMATRIX_BUTTON_NONE) {
+    if (is_libinput_connected) {
+        bbx_indev_stop_monitor();
+        /* Auto-connecting closes all connected devices first, so allowing no device types leaves none behind */
+        bbx_indev_auto_connect(false, false, false);
+        is_libinput_connected = false;
+    }
+}
+
+static void set_keyboard_hidden(bool hidden) {
+    if (hidden == is_hidden) {
         return;
     }
+    is_hidden = hidden;
+
+    if (hidden) {
+        bbx_log(BBX_LOG_LEVEL_VERBOSE, "Hiding keyboard");
+
+        /* Don't leave any modifiers stuck while we're gone */
+        bb_keyboard_release_modifiers(keyboard);
+
+        /* Hidden objects don't receive input, so any touch now lands on the screen */
+        lv_obj_add_flag(keyboard, LV_OBJ_FLAG_HIDDEN);
+
+        if (resize_terminals) {
+            bb_terminal_reset_all();
+        }
+
+        bb_main_loop_set_paused(true);
+    } else {
+        bbx_log(BBX_LOG_LEVEL_VERBOSE, "Showing keyboard");
+
+        if (resize_terminals) {
+            bb_terminal_shrink_current();
+            if (conf_opts.terminal.eager_resize) {
+                bb_terminal_start_eager_resize();
+            }
+        }
+
+        /* The console has drawn over our area in the meantime */
+        lv_obj_remove_flag(keyboard, LV_OBJ_FLAG_HIDDEN);
+        lv_obj_invalidate(lv_scr_act());
+
+        bb_main_loop_set_paused(false);
+    }
+}
 
-    if (sq2lv_is_layer_switcher(kb, btn_id)) {
-        pop_checked_modifier_keys();
-        sq2lv_switch_layer(kb, btn_id);
+static void screen_pressed_cb(lv_event_t *event) {
+    if (!is_hidden) {
         return;
     }
 
-    /* Note that the LV_BUTTONMATRIX_CTRL_CHECKED logic is inverted because LV_KEYBOARD_CTRL_BTN_FLAGS already
-     * contains LV_BUTTONMATRIX_CTRL_CHECKED. As a result, pressing e.g. CTRL will _un_check the key. To account
-     * for this, we invert the meaning of "checked" here and elsewhere in the code. */
+    set_keyboard_hidden(false);
 
-    bool is_modifier = sq2lv_is_modifier(keyboard, btn_id);
-    bool is_checked = !lv_buttonmatrix_has_button_ctrl(keyboard, btn_id, LV_BUTTONMATRIX_CTRL_CHECKED);
+    /* Don't let the touch that brought the keyboard back press a key */
+    lv_indev_wait_release(lv_indev_active());
+}
 
-    /* Emit key events. Suppress key up events for modifiers unless they were unchecked. For checked modifiers
-     * the key up events are sent with the next non-modifier key press. */
-    emit_key_events(btn_id, true, !is_modifier || !is_checked);
+static void hardware_keyboard_cb(bool connected) {
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, connected ? "Hardware keyboard connected" : "Hardware keyboard disconnected");
+    set_keyboard_hidden(connected);
+}
 
-    /* Pop any previously checked modifiers when a non-modifier key was pressed */
-    if (!is_modifier) {
-        pop_checked_modifier_keys();
+static void signal_cb(int fd, void *user_data) {
+    struct signalfd_siginfo info;
+    while (read(fd, &info, sizeof(info)) == sizeof(info)) {
+        if (info.ssi_signo == SIGINT || info.ssi_signo == SIGTERM) {
+            if (resize_terminals) {
+                bb_terminal_reset_all();
+            }
+            bb_control_stop();
+            bb_trace_flush();
+            exit(0);
+        } else if (info.ssi_signo == SIGUSR1) {
+            bb_diagnostics_dump(lv_display_get_default());
+            if (resize_terminals) {
+                bb_terminal_log_state();
+            }
+            bb_trace_flush();
+        } else if (info.ssi_signo == SIGUSR2) {
+            set_keyboard_hidden(!is_hidden);
+        }
     }
 }
 
-static void emit_key_events(uint16_t btn_id, bool key_down, bool key_up) {
-    int num_scancodes = 0;
-    const int *scancodes = sq2lv_get_scancodes(keyboard, btn_id, &num_scancodes);
+static bool control_cb(const char *command, const char *arg, char *reply, size_t reply_size) {
+    /* Changes are applied in place and rendered by the next run of LVGL's timers. They're not written back into
+     * conf_opts, so they stay in effect until the corresponding option changes in the config files. */
+    if (strcmp(command, "show") == 0) {
+        set_keyboard_hidden(false);
+        return true;
+    }
 
-    if (key_down) {
-        /* Emit key down events in forward order */
-        for (int i = 0; i < num_scancodes; ++i) {
-            bb_uinput_device_emit_key_down(scancodes[i]);
+    if (strcmp(command, "hide") == 0) {
+        set_keyboard_hidden(true);
+        return true;
+    }
+
+    if (strcmp(command, "toggle") == 0) {
+        set_keyboard_hidden(!is_hidden);
+        return true;
+    }
+
+    if (strcmp(command, "layout") == 0) {
+        if (!bb_keyboard_switch_layout(keyboard, arg)) {
+            snprintf(reply, reply_size, "could not switch to layout \"%s\"", arg);
+            return false;
         }
+        return true;
     }
 
-    if (key_up) {
-        /* Emit key up events in backward order */
-        for (int i = num_scancodes - 1; i >= 0; --i) {
-            bb_uinput_device_emit_key_up(scancodes[i]);
+    if (strcmp(command, "layer") == 0) {
+        int index = -1;
+        if (sscanf(arg, "%d", &index) != 1 || !bb_keyboard_set_layer(keyboard, index)) {
+            snprintf(reply, reply_size, "invalid layer \"%s\"", arg);
+            return false;
         }
+        return true;
     }
-}
 
-static void pop_checked_modifier_keys(void) {
-    int num_modifiers = 0;
-    const int *modifier_idxs = sq2lv_get_modifier_indexes(keyboard, &num_modifiers);
+    if (strcmp(command, "theme") == 0) {
+        bbx_themes_theme_id_t id = bbx_themes_find_theme_with_name(arg);
+        if (id == BBX_THEMES_THEME_NONE) {
+            snprintf(reply, reply_size, "unknown theme \"%s\"", arg);
+            return false;
+        }
+        bbx_theme_apply(bbx_themes_themes[id]);
+        return true;
+    }
+
+    if (strcmp(command, "reset-terminals") == 0) {
+        if (!resize_terminals) {
+            snprintf(reply, reply_size, "terminal resizing is unavailable");
+            return false;
+        }
+
+        /* Restore every terminal and shrink the current one again if the keyboard still covers it */
+        bb_terminal_reset_all();
+        if (!is_hidden) {
+            bb_terminal_shrink_current();
+            if (conf_opts.terminal.eager_resize) {
+                bb_terminal_start_eager_resize();
+            }
+        }
+        return true;
+    }
+
+    if (strcmp(command, "type") == 0) {
+        int num_chars = 0;
+        if (!bb_key_injection_type(arg, &num_chars, reply, reply_size)) {
+            return false;
+        }
+        snprintf(reply, reply_size, "%d", num_chars);
+        return true;
+    }
 
-    for (int i = 0; i < num_modifiers; ++i) {
-        if (!lv_buttonmatrix_has_button_ctrl(keyboard, modifier_idxs[i], LV_BUTTONMATRIX_CTRL_CHECKED)) {
-            emit_key_events(modifier_idxs[i], false, true);
-            lv_buttonmatrix_set_button_ctrl(keyboard, modifier_idxs[i], LV_BUTTONMATRIX_CTRL_CHECKED);
+    if (strcmp(command, "keys") == 0) {
+        int num_combos = 0;
+        if (!bb_key_injection_press(arg, &num_combos, reply, reply_size)) {
+            return false;
         }
+        snprintf(reply, reply_size, "%d", num_combos);
+        return true;
     }
+
+    if (strcmp(command, "delay") == 0) {
+        unsigned int delay = 0;
+        char extra;
+        if (sscanf(arg, "%u%c", &delay, &extra) != 1 || delay > 10000) {
+            snprintf(reply, reply_size, "invalid delay \"%s\"", arg);
+            return false;
+        }
+        bb_key_injection_set_delay(delay);
+        return true;
+    }
+
+    if (strcmp(command, "stats") == 0) {
+        const bb_layout *layout = bb_layout_get_current();
+        int len = snprintf(reply, reply_size, "hidden=%d layout=%s layer=%d ", is_hidden,
+            layout ? layout->short_name : "", bb_layout_get_current_layer_index());
+        if (len >= 0 && (size_t)len < reply_size) {
+            bb_stats_format(reply + len, reply_size - len);
+        }
+        return true;
+    }
+
+    snprintf(reply, reply_size, "unknown command \"%s\"", command);
+    return false;
 }
 
+static void terminal_resize_timer_cb(lv_timer_t *timer) {
+    if (resize_terminals) {
+        bb_terminal_shrink_current();
+    }
+}
+
+static void emit_key_cb(int scancode, bool pressed) {
+    if (pressed) {
+        bb_uinput_device_emit_key_down(scancode);
+    } else {
+        bb_uinput_device_emit_key_up(scancode);
+    }
+}
 
 /**
  * Main
@@ -181,43 +544,71 @@ int main(int argc, char *argv[]) {
     /* Parse command line options */
     bb_cli_parse_opts(argc, argv, &cli_opts);
 
+    /* Start timing startup phases if requested */
+    if (cli_opts.startup_trace) {
+        bb_startup_trace_enable();
+    }
+
     /* Set up log level */
     if (cli_opts.verbose) {
         bbx_log_set_level(BBX_LOG_LEVEL_VERBOSE);
     }
 
+    /* Compile the built-in layouts into layout files instead of running the keyboard if requested */
+    if (cli_opts.export_layouts_dir) {
+        return bb_layout_export(cli_opts.export_layouts_dir) ? 0 : 1;
+    }
+
     /* Parse config files */
-    bb_config_init_opts(&conf_opts);
-    bb_config_parse_file("/usr/share/buffyboard/buffyboard.conf", &conf_opts);
-    bb_config_parse_directory("/usr/share/buffyboard/buffyboard.conf.d", &conf_opts);
-    bb_config_parse_file("/etc/buffyboard.conf", &conf_opts);
-    bb_config_parse_directory("/etc/buffyboard.conf.d", &conf_opts);
-    bb_config_parse_files(cli_opts.config_files, cli_opts.num_config_files, &conf_opts);
-
-    /* Prepare for terminal resizing and reset */
-    resize_terminals = bb_terminal_init(2.0f / 3.0f);
-    if (resize_terminals) {
-        /* Clean up on termination */
-        struct sigaction action;
-        lv_memset(&action, 0, sizeof(action));
-        action.sa_handler = sigaction_handler;
-        sigaction(SIGINT, &action, NULL);
-        sigaction(SIGTERM, &action, NULL);
+    int phase = bb_startup_trace_begin("config");
+    load_config(&conf_opts);
+    bb_startup_trace_end(phase);
 
-        /* Resize current terminal */
-        bb_terminal_shrink_current();
+    /* Prepare main loop */
+    if (!bb_main_loop_init()) {
+        return 1;
     }
 
-    /* Set up uinput device */
-    if (!bb_uinput_device_init(sq2lv_unique_scancodes, sq2lv_num_unique_scancodes)) {
+    /* Clean up on termination, dump diagnostics and write the trace on SIGUSR1 and toggle visibility on SIGUSR2.
+     * The signals are blocked before any threads are spawned so that all threads inherit the mask. */
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    sigaddset(&signals, SIGUSR1);
+    sigaddset(&signals, SIGUSR2);
+    sigprocmask(SIG_BLOCK, &signals, NULL);
+    int signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (signal_fd < 0 || !bb_main_loop_add_fd(signal_fd, signal_cb, NULL)) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not set up signal handling");
         return 1;
     }
 
+    /* Set up uinput device. This doesn't depend on LVGL and udev needs a moment to process the new device
+     * anyway, so do it in the background. */
+    pthread_t uinput_thread;
+    bool join_uinput_thread = run_in_background(&uinput_thread, uinput_device_worker);
+
+    /* Paint the keyboard as it looked on the previous start while LVGL builds the real one */
+    phase = bb_startup_trace_begin("snapshot");
+    char layout_source[64];
+    bb_layout_describe_source(conf_opts.layout.default_name, layout_source, sizeof(layout_source));
+    char snapshot_key[192];
+    snprintf(snapshot_key, sizeof(snapshot_key),
+        "version=%s theme=%d geometry=%dx%d@%d,%d dpi=%d rotation=%d layout_source=%s layout=%s",
+        PROJECT_VERSION, conf_opts.theme.default_id, cli_opts.hor_res, cli_opts.ver_res, cli_opts.x_offset,
+        cli_opts.y_offset, cli_opts.dpi, cli_opts.rotation, layout_source, conf_opts.layout.default_name);
+    bb_snapshot_paint(snapshot_key);
+    bb_startup_trace_end(phase);
+
     /* Initialise LVGL and set up logging callback */
+    phase = bb_startup_trace_begin("lvgl");
     lv_init();
     lv_log_register_print_cb(bbx_log_print_cb);
+    bb_startup_trace_end(phase);
 
     /* Initialise display */
+    phase = bb_startup_trace_begin("display");
     lv_display_t *disp = lv_linux_fbdev_create();
     lv_linux_fbdev_set_file(disp, "/dev/fb0");
     if (conf_opts.quirks.fbdev_force_refresh) {
@@ -239,53 +630,105 @@ int main(int argc, char *argv[]) {
     int32_t ver_res_phys = lv_display_get_vertical_resolution(disp);
     lv_display_set_physical_resolution(disp, hor_res_phys, ver_res_phys);
     lv_display_set_rotation(disp, cli_opts.rotation);
+    int32_t offset_y = 0;
     switch (cli_opts.rotation) {
         case LV_DISPLAY_ROTATION_0:
         case LV_DISPLAY_ROTATION_180: {
-            lv_coord_t denom = keyboard_height_denominator(hor_res_phys, ver_res_phys);
+            lv_coord_t denom = bb_keyboard_height_denominator(hor_res_phys, ver_res_phys);
             lv_display_set_resolution(disp, hor_res_phys, ver_res_phys / denom);
-            lv_display_set_offset(disp, 0, (cli_opts.rotation == LV_DISPLAY_ROTATION_0) ? (denom - 1) * ver_res_phys / denom : 0);
+            offset_y = (cli_opts.rotation == LV_DISPLAY_ROTATION_0) ? (denom - 1) * ver_res_phys / denom : 0;
             break;
         }
         case LV_DISPLAY_ROTATION_90:
         case LV_DISPLAY_ROTATION_270: {
-            lv_coord_t denom = keyboard_height_denominator(ver_res_phys, hor_res_phys);
+            lv_coord_t denom = bb_keyboard_height_denominator(ver_res_phys, hor_res_phys);
             lv_display_set_resolution(disp, hor_res_phys / denom, ver_res_phys);
-            lv_display_set_offset(disp, 0, (cli_opts.rotation == LV_DISPLAY_ROTATION_90) ? (denom - 1) * hor_res_phys / denom : 0);
+            offset_y = (cli_opts.rotation == LV_DISPLAY_ROTATION_90) ? (denom - 1) * hor_res_phys / denom : 0;
             break;
         }
     }
+    lv_display_set_offset(disp, 0, offset_y);
+
+    /* Apply performance tunables */
+    bb_performance_apply(disp, &conf_opts.performance);
+
+    /* Record a trace if requested */
+    if (cli_opts.trace_file) {
+        bb_trace_init(cli_opts.trace_file, disp);
+    }
 
-    /* Start input device monitor and auto-connect available devices */
-    bbx_indev_start_monitor_and_autoconnect(false, conf_opts.input.pointer, conf_opts.input.touchscreen);
+    /* Collect performance statistics if requested */
+    if (cli_opts.stats_interval > 0) {
+        bb_stats_init(disp, cli_opts.stats_interval);
+    }
+    bb_startup_trace_end(phase);
+
+    /* Prepare for terminal resizing and reset. Only the display geometry is needed for this, so let it run
+     * while the rest of the UI is being built. */
+    bool is_sideways = (cli_opts.rotation == LV_DISPLAY_ROTATION_90 || cli_opts.rotation == LV_DISPLAY_ROTATION_270);
+    terminal_total_height = is_sideways ? hor_res_phys : ver_res_phys;
+    terminal_occupied_height = lv_display_get_vertical_resolution(disp);
+    pthread_t terminal_thread;
+    bool join_terminal_thread = run_in_background(&terminal_thread, terminal_worker);
+
+    /* Connect input devices */
+    phase = bb_startup_trace_begin("input devices");
+    get_physical_display_area(disp, 0, offset_y, &display_area);
+    connect_input_devices(&conf_opts.input);
+    bb_startup_trace_end(phase);
 
     /* Initialise theme */
+    phase = bb_startup_trace_begin("theme");
     bbx_theme_apply(bbx_themes_themes[conf_opts.theme.default_id]);
+    bb_startup_trace_end(phase);
 
     /* Add keyboard */
-    keyboard = lv_keyboard_create(lv_scr_act());
-    uint32_t num_keyboard_events = lv_obj_get_event_count(keyboard);
-    for(uint32_t i = 0; i < num_keyboard_events; ++i) {
-        if(lv_event_dsc_get_cb(lv_obj_get_event_dsc(keyboard, i)) == lv_keyboard_def_event_cb) {
-            lv_obj_remove_event(keyboard, i);
-            break;
+    phase = bb_startup_trace_begin("keyboard");
+    keyboard = bb_keyboard_create(lv_scr_act(), conf_opts.layout.default_name, emit_key_cb);
+
+    /* Show the keyboard again when touching the screen while it's hidden */
+    lv_obj_add_event_cb(lv_scr_act(), screen_pressed_cb, LV_EVENT_PRESSED, NULL);
+    bb_startup_trace_end(phase);
+
+    /* Wait for the background work to finish before anything can emit keys or reset terminals */
+    if (join_terminal_thread) {
+        pthread_join(terminal_thread, NULL);
+    }
+    if (join_uinput_thread) {
+        pthread_join(uinput_thread, NULL);
+    }
+    if (!uinput_device_ready) {
+        if (resize_terminals) {
+            bb_terminal_reset_all();
         }
+        return 1;
+    }
+
+    /* Get out of the way while a hardware keyboard is in use */
+    if (conf_opts.input.hide_on_hardware_keyboard) {
+        bb_hardware_keyboard_monitor_init(hardware_keyboard_cb);
     }
-    lv_obj_add_event_cb(keyboard, keyboard_value_changed_cb, LV_EVENT_VALUE_CHANGED, NULL);
-    lv_obj_set_pos(keyboard, 0, 0);
-    lv_obj_set_size(keyboard, LV_HOR_RES, LV_VER_RES);
-    bbx_theme_prepare_keyboard(keyboard);
 
-    /* Apply default keyboard layout */
-    sq2lv_switch_layout(keyboard, SQ2LV_LAYOUT_TERMINAL_US);
+    /* Re-apply options when config files change */
+    bb_config_watch_init(cli_opts.config_files, cli_opts.num_config_files, config_changed_cb);
+
+    /* Accept commands from other processes. This changes the umask briefly, so it must not race with the
+     * background workers. */
+    if (cli_opts.control_socket[0] != '\0') {
+        bb_control_init(cli_opts.control_socket, control_cb);
+    }
 
     /* Start timer for periodically resizing terminals */
     lv_timer_create(terminal_resize_timer_cb, 1000,  NULL);
 
-    /* Periodically run timer / task handler */
-    while(1) {
-        lv_timer_periodic_handler();
-    }
+    /* Save a snapshot of the keyboard for the next start */
+    bb_snapshot_save_after_first_frame(disp, &display_area);
+
+    /* Print the startup trace once the keyboard is on screen */
+    bb_startup_trace_report_after_first_frame(disp);
+
+    /* Run timers and read input devices as soon as they have data */
+    bb_main_loop_run();
 
     return 0;
 }
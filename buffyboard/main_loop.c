@@ -0,0 +1,358 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "main_loop.h"
+
+#include "trace.h"
+
+#include "../shared/log.h"
+
+#include "lvgl/lvgl.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/epoll.h>
+
+
+/**
+ * Defines
+ */
+
+/* Maximum number of file descriptors that can be watched in addition to input devices */
+#define MAX_FD_WATCHES 16
+
+/* Maximum number of input devices that can be watched */
+#define MAX_INDEV_WATCHES 16
+
+/* Maximum number of events to retrieve per loop iteration */
+#define MAX_EVENTS 16
+
+/* Bit used for distinguishing input device watches from regular file descriptor watches in epoll data */
+#define INDEV_WATCH_BIT 0x80000000u
+
+/* Delay in ms after which an input device is read again following a wakeup (see bb_main_loop_run) */
+#define INDEV_REREAD_DELAY 1
+
+
+/**
+ * Static types
+ */
+
+/* File descriptor watch */
+typedef struct {
+    /* Watched file descriptor or -1 if the slot is free */
+    int fd;
+    /* Callback to invoke when the file descriptor is readable */
+    bb_main_loop_fd_cb cb;
+    /* Pointer to pass through to the callback */
+    void *user_data;
+} fd_watch;
+
+/* Input device watch */
+typedef struct {
+    /* Watched input device or NULL if the slot is free */
+    lv_indev_t *indev;
+    /* The device's file descriptor or -1 if it doesn't have one */
+    int fd;
+    /* True if the device was found during the current sync */
+    bool seen;
+    /* True if the device should be read again after INDEV_REREAD_DELAY */
+    bool reread;
+} indev_watch;
+
+
+/**
+ * Static variables
+ */
+
+static int epoll_fd = -1;
+static fd_watch fd_watches[MAX_FD_WATCHES];
+static indev_watch indev_watches[MAX_INDEV_WATCHES];
+static bool is_paused = false;
+static uint32_t indev_read_period = 0;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Synchronise the watched input devices with LVGL's current list of input devices. Devices may come and
+ * go at any time due to hotplugging.
+ */
+static void sync_indev_watches(void);
+
+/**
+ * Find the watch slot for an input device.
+ *
+ * @param indev input device
+ * @return slot index or -1 if the device is not being watched
+ */
+static int find_indev_watch(lv_indev_t *indev);
+
+/**
+ * Retrieve the file descriptor of an input device.
+ *
+ * @param indev input device
+ * @return file descriptor or -1 if the device doesn't have one
+ */
+static int get_indev_fd(lv_indev_t *indev);
+
+/**
+ * Read an input device and record the read in the trace.
+ *
+ * @param indev input device
+ */
+static void read_indev(lv_indev_t *indev);
+
+
+/**
+ * Static functions
+ */
+
+static void sync_indev_watches(void) {
+    for (int i = 0; i < MAX_INDEV_WATCHES; ++i) {
+        indev_watches[i].seen = false;
+    }
+
+    /* A device that was reconnected in place can reuse the address of a deleted one, so only treat it as known
+     * if its file descriptor still matches */
+    lv_indev_t *indev = NULL;
+    while ((indev = lv_indev_get_next(indev)) != NULL) {
+        int slot = find_indev_watch(indev);
+        if (slot >= 0 && indev_watches[slot].fd == get_indev_fd(indev)) {
+            indev_watches[slot].seen = true;
+        }
+    }
+
+    /* Drop watches of removed devices first so that reused file descriptor numbers can be re-added below */
+    for (int i = 0; i < MAX_INDEV_WATCHES; ++i) {
+        if (!indev_watches[i].indev || indev_watches[i].seen) {
+            continue;
+        }
+        /* Closing the descriptor usually removes it from the epoll set already, so ignore errors here */
+        if (indev_watches[i].fd >= 0) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, indev_watches[i].fd, NULL);
+        }
+        indev_watches[i].indev = NULL;
+        indev_watches[i].fd = -1;
+    }
+
+    indev = NULL;
+    while ((indev = lv_indev_get_next(indev)) != NULL) {
+        if (find_indev_watch(indev) >= 0) {
+            continue;
+        }
+
+        int slot = find_indev_watch(NULL);
+        if (slot < 0) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "Could not watch input device, too many devices connected");
+            return;
+        }
+
+        if (indev_read_period > 0) {
+            lv_timer_set_period(lv_indev_get_read_timer(indev), indev_read_period);
+        }
+
+        /* The device is read on every edge only. LVGL drains all pending events per read so there's no need
+         * for level-triggered wakeups. */
+        int fd = get_indev_fd(indev);
+        if (fd >= 0) {
+            struct epoll_event event;
+            memset(&event, 0, sizeof(event));
+            event.events = EPOLLIN | EPOLLET;
+            event.data.u32 = INDEV_WATCH_BIT | (uint32_t)slot;
+            if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                /* Keep the descriptor anyway so that the device isn't retried on every sync. It's still read
+                 * by its timer. */
+                bbx_log(BBX_LOG_LEVEL_ERROR, "Could not watch input device: %s", strerror(errno));
+            }
+        }
+
+        indev_watches[slot].indev = indev;
+        indev_watches[slot].fd = fd;
+        indev_watches[slot].seen = true;
+        indev_watches[slot].reread = false;
+    }
+}
+
+static int find_indev_watch(lv_indev_t *indev) {
+    for (int i = 0; i < MAX_INDEV_WATCHES; ++i) {
+        if (indev_watches[i].indev == indev) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static int get_indev_fd(lv_indev_t *indev) {
+    /* All devices connected via shared/indev use LVGL's libinput driver and carry its state as driver data.
+     * Devices without driver data are managed elsewhere and register their file descriptors themselves. */
+    lv_libinput_t *dsc = lv_indev_get_driver_data(indev);
+    return dsc ? dsc->fd : -1;
+}
+
+static void read_indev(lv_indev_t *indev) {
+    uint64_t start = bb_trace_begin();
+    lv_indev_read(indev);
+    bb_trace_end("indev read", start);
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_main_loop_init(void) {
+    for (int i = 0; i < MAX_FD_WATCHES; ++i) {
+        fd_watches[i].fd = -1;
+    }
+    for (int i = 0; i < MAX_INDEV_WATCHES; ++i) {
+        indev_watches[i].indev = NULL;
+        indev_watches[i].fd = -1;
+    }
+
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not create epoll instance: %s", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+bool bb_main_loop_add_fd(int fd, bb_main_loop_fd_cb cb, void *user_data) {
+    int slot = -1;
+    for (int i = 0; i < MAX_FD_WATCHES; ++i) {
+        if (fd_watches[i].fd < 0) {
+            slot = i;
+            break;
+        }
+    }
+
+    if (slot < 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not watch file descriptor, too many watches");
+        return false;
+    }
+
+    struct epoll_event event;
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.u32 = (uint32_t)slot;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not watch file descriptor: %s", strerror(errno));
+        return false;
+    }
+
+    fd_watches[slot].fd = fd;
+    fd_watches[slot].cb = cb;
+    fd_watches[slot].user_data = user_data;
+    return true;
+}
+
+void bb_main_loop_remove_fd(int fd) {
+    for (int i = 0; i < MAX_FD_WATCHES; ++i) {
+        if (fd_watches[i].fd == fd) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, NULL);
+            fd_watches[i].fd = -1;
+            return;
+        }
+    }
+}
+
+void bb_main_loop_set_paused(bool paused) {
+    is_paused = paused;
+}
+
+void bb_main_loop_set_indev_read_period(uint32_t period) {
+    indev_read_period = period;
+}
+
+int bb_main_loop_dispatch(int timeout) {
+    struct epoll_event events[MAX_EVENTS];
+
+    int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+    if (num_events < 0) {
+        if (errno == EINTR) {
+            return 0;
+        }
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not wait for events: %s", strerror(errno));
+        return -1;
+    }
+
+    for (int i = 0; i < num_events; ++i) {
+        uint32_t data = events[i].data.u32;
+        if (data & INDEV_WATCH_BIT) {
+            continue;
+        }
+
+        fd_watch *watch = &fd_watches[data];
+        if (watch->fd >= 0) {
+            watch->cb(watch->fd, watch->user_data);
+        }
+    }
+
+    return num_events;
+}
+
+void bb_main_loop_run(void) {
+    struct epoll_event events[MAX_EVENTS];
+
+    while (1) {
+        uint32_t time_till_next = is_paused ? LV_NO_TIMER_READY : lv_timer_handler();
+
+        /* Input devices might have been (dis)connected while running the timers */
+        sync_indev_watches();
+
+        int timeout = (time_till_next == LV_NO_TIMER_READY) ? -1 : (int)time_till_next;
+
+        /* LVGL's libinput driver dispatches events on a worker thread which races with our wakeup. If the
+         * device was read before the worker queued the events, they would only be picked up by the regular
+         * read timer. Read such devices once more after a short delay to keep the latency bounded. */
+        bool reread_pending = false;
+        for (int i = 0; i < MAX_INDEV_WATCHES; ++i) {
+            reread_pending |= (indev_watches[i].indev && indev_watches[i].reread);
+        }
+        if (reread_pending && (timeout < 0 || timeout > INDEV_REREAD_DELAY)) {
+            timeout = INDEV_REREAD_DELAY;
+        }
+
+        int num_events = epoll_wait(epoll_fd, events, MAX_EVENTS, timeout);
+        if (num_events < 0) {
+            if (errno != EINTR) {
+                bbx_log(BBX_LOG_LEVEL_ERROR, "Could not wait for events: %s", strerror(errno));
+            }
+            continue;
+        }
+
+        for (int i = 0; i < MAX_INDEV_WATCHES; ++i) {
+            if (indev_watches[i].indev && indev_watches[i].reread) {
+                indev_watches[i].reread = false;
+                read_indev(indev_watches[i].indev);
+            }
+        }
+
+        for (int i = 0; i < num_events; ++i) {
+            uint32_t data = events[i].data.u32;
+
+            if (data & INDEV_WATCH_BIT) {
+                indev_watch *watch = &indev_watches[data & ~INDEV_WATCH_BIT];
+                if (watch->indev) {
+                    read_indev(watch->indev);
+                    watch->reread = true;
+                }
+                continue;
+            }
+
+            fd_watch *watch = &fd_watches[data];
+            if (watch->fd >= 0) {
+                watch->cb(watch->fd, watch->user_data);
+            }
+        }
+    }
+}
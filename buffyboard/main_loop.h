@@ -0,0 +1,78 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_MAIN_LOOP_H
+#define BB_MAIN_LOOP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Callback for file descriptors that became readable.
+ *
+ * @param fd the readable file descriptor
+ * @param user_data user data supplied when adding the file descriptor
+ */
+typedef void (*bb_main_loop_fd_cb)(int fd, void *user_data);
+
+/**
+ * Prepare the main loop. Must be called before any other bb_main_loop_* function.
+ *
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_main_loop_init(void);
+
+/**
+ * Watch a file descriptor and invoke a callback from the main loop whenever it becomes readable.
+ *
+ * @param fd file descriptor to watch
+ * @param cb callback to invoke
+ * @param user_data pointer to pass through to the callback
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_main_loop_add_fd(int fd, bb_main_loop_fd_cb cb, void *user_data);
+
+/**
+ * Stop watching a file descriptor.
+ *
+ * @param fd file descriptor to stop watching
+ */
+void bb_main_loop_remove_fd(int fd);
+
+/**
+ * Pause or resume LVGL's timers. While paused, nothing is rendered and the process sleeps until one of the
+ * watched file descriptors becomes readable. Input devices are still read so that LVGL events can be used
+ * to resume.
+ *
+ * @param paused true to pause, false to resume
+ */
+void bb_main_loop_set_paused(bool paused);
+
+/**
+ * Override the read timer period of all input devices that are connected from now on. Since devices are read
+ * as soon as they have data, the timer only acts as a fallback.
+ *
+ * @param period period in ms or 0 to keep LVGL's default
+ */
+void bb_main_loop_set_indev_read_period(uint32_t period);
+
+/**
+ * Wait until watched file descriptors become readable and invoke their callbacks once, without running LVGL's
+ * timers or reading input devices. Used to drive key injection from the benchmarks.
+ *
+ * @param timeout maximum time to wait in ms or -1 to wait indefinitely
+ * @return number of readable file descriptors or -1 on failure
+ */
+int bb_main_loop_dispatch(int timeout);
+
+/**
+ * Run LVGL's timer handler and dispatch file descriptor events forever. Between timer runs, the
+ * process sleeps until either the next timer is due or one of the watched file descriptors (including
+ * those of connected input devices) becomes readable.
+ */
+void bb_main_loop_run(void);
+
+#endif /* BB_MAIN_LOOP_H */
@@ -0,0 +1,134 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "performance.h"
+
+#include "main_loop.h"
+
+#include "../shared/log.h"
+
+#include <stdlib.h>
+
+
+/**
+ * Static variables
+ */
+
+/* Size in KiB of the memory pool that was actually added to LVGL's allocator */
+static int added_pool_size = 0;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Replace the display's draw buffer with one of the given height.
+ *
+ * @param disp display
+ * @param lines height of the buffer in lines
+ */
+static void set_draw_buffer_lines(lv_display_t *disp, int lines);
+
+/**
+ * Make additional memory available to LVGL's built-in allocator.
+ *
+ * @param size size in KiB
+ */
+static void add_memory_pool(int size);
+
+
+/**
+ * Static functions
+ */
+
+static void set_draw_buffer_lines(lv_display_t *disp, int lines) {
+#if LV_LINUX_FBDEV_RENDER_MODE == LV_DISPLAY_RENDER_MODE_PARTIAL && LV_LINUX_FBDEV_BUFFER_COUNT != 2
+    int32_t width = lv_display_get_horizontal_resolution(disp);
+    int32_t height = lv_display_get_vertical_resolution(disp);
+    uint32_t size = (uint32_t)LV_MIN(lines, height) * width
+        * lv_color_format_get_size(lv_display_get_color_format(disp));
+
+    lv_draw_buf_t *current = lv_display_get_buf_active(disp);
+    if (current && current->data_size == size) {
+        return;
+    }
+
+    /* Like the memory pool, the buffer is allocated outside of LVGL so that it doesn't use up the widgets' heap */
+    void *buffer = malloc(size);
+    if (!buffer) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate draw buffer of %u bytes", size);
+        return;
+    }
+
+    void *previous = current ? current->unaligned_data : NULL;
+    lv_display_set_buffers(disp, buffer, NULL, size, LV_DISPLAY_RENDER_MODE_PARTIAL);
+
+    /* The fbdev driver allocates its buffer with malloc as well, so it can be released in the same way */
+    free(previous);
+#elif LV_LINUX_FBDEV_RENDER_MODE == LV_DISPLAY_RENDER_MODE_PARTIAL
+    /* LVGL only exposes the active buffer, so the driver's second one couldn't be released */
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Ignoring draw buffer size, fbdev driver uses double buffering");
+#else
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Ignoring draw buffer size, fbdev driver doesn't use partial rendering");
+#endif
+}
+
+static void add_memory_pool(int size) {
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+    /* The pool is never released, so it's allocated outside of LVGL */
+    size_t bytes = (size_t)size * 1024;
+    void *pool = malloc(bytes);
+    if (!pool || !lv_mem_add_pool(pool, bytes)) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not add memory pool of %d KiB", size);
+        free(pool);
+        return;
+    }
+    added_pool_size = size;
+#else
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Ignoring memory pool size, LVGL doesn't use its built-in allocator");
+#endif
+}
+
+
+/**
+ * Public functions
+ */
+
+void bb_performance_apply(lv_display_t *disp, const bb_config_opts_performance *opts) {
+    if (opts->memory_pool_size > 0) {
+        add_memory_pool(opts->memory_pool_size);
+    }
+
+    if (opts->refresh_period > 0) {
+        lv_timer_set_period(lv_display_get_refr_timer(disp), opts->refresh_period);
+    }
+
+    if (opts->input_read_period > 0) {
+        bb_main_loop_set_indev_read_period(opts->input_read_period);
+    }
+
+    if (opts->draw_buffer_lines > 0) {
+        set_draw_buffer_lines(disp, opts->draw_buffer_lines);
+    }
+
+    if (opts->image_cache_size > 0) {
+        lv_image_cache_resize((uint32_t)opts->image_cache_size * 1024, true);
+    }
+
+    lv_draw_buf_t *draw_buf = lv_display_get_buf_active(disp);
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Refresh period: %d ms",
+        opts->refresh_period > 0 ? opts->refresh_period : LV_DEF_REFR_PERIOD);
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Input read period: %d ms",
+        opts->input_read_period > 0 ? opts->input_read_period : LV_INDEV_DEF_READ_PERIOD);
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Draw buffer size: %u bytes", draw_buf ? draw_buf->data_size : 0);
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Software renderer threads: %d (fixed at build time)", LV_DRAW_SW_DRAW_UNIT_CNT);
+#if LV_USE_STDLIB_MALLOC == LV_STDLIB_BUILTIN
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Memory pool size: %d KiB", LV_MEM_SIZE / 1024 + added_pool_size);
+#endif
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Image cache size: %d KiB",
+        opts->image_cache_size > 0 ? opts->image_cache_size : LV_CACHE_DEF_SIZE / 1024);
+}
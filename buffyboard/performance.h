@@ -0,0 +1,23 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_PERFORMANCE_H
+#define BB_PERFORMANCE_H
+
+#include "config.h"
+
+#include "lvgl/lvgl.h"
+
+/**
+ * Apply performance tunables to LVGL and a display and log the effective values. Must be called after
+ * the display's resolution and rotation have been set up and before any input devices are connected.
+ *
+ * @param disp display to apply display-related options to
+ * @param opts performance options
+ */
+void bb_performance_apply(lv_display_t *disp, const bb_config_opts_performance *opts);
+
+#endif /* BB_PERFORMANCE_H */
@@ -0,0 +1,142 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "png.h"
+
+#include "../shared/log.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <zlib.h>
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Store a 32-bit value in network byte order.
+ *
+ * @param buf buffer to write into
+ * @param value value to store
+ */
+static void put_u32(uint8_t *buf, uint32_t value);
+
+/**
+ * Write a PNG chunk.
+ *
+ * @param file file to write into
+ * @param type four-character chunk type
+ * @param data chunk data
+ * @param size number of bytes in data
+ * @return true on success, false otherwise
+ */
+static bool write_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t size);
+
+
+/**
+ * Static functions
+ */
+
+static void put_u32(uint8_t *buf, uint32_t value) {
+    buf[0] = value >> 24;
+    buf[1] = value >> 16;
+    buf[2] = value >> 8;
+    buf[3] = value;
+}
+
+static bool write_chunk(FILE *file, const char *type, const uint8_t *data, uint32_t size) {
+    uint8_t header[8];
+    put_u32(header, size);
+    header[4] = type[0];
+    header[5] = type[1];
+    header[6] = type[2];
+    header[7] = type[3];
+
+    /* The checksum covers the type and the data but not the length */
+    uLong crc = crc32(0, header + 4, 4);
+    if (size > 0) {
+        /* Passing NULL would reset the checksum */
+        crc = crc32(crc, data, size);
+    }
+    uint8_t footer[4];
+    put_u32(footer, crc);
+
+    return fwrite(header, 1, sizeof(header), file) == sizeof(header)
+        && fwrite(data, 1, size, file) == size
+        && fwrite(footer, 1, sizeof(footer), file) == sizeof(footer);
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_png_write_xrgb8888(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height,
+        uint32_t stride) {
+    /* Each row starts with a filter type byte followed by the RGB triplets */
+    size_t row_size = 1 + (size_t)width * 3;
+    size_t raw_size = row_size * height;
+    uint8_t *raw = malloc(raw_size);
+    uLongf compressed_size = compressBound(raw_size);
+    uint8_t *compressed = malloc(compressed_size);
+    if (!raw || !compressed) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for %s", path);
+        free(raw);
+        free(compressed);
+        return false;
+    }
+
+    for (uint32_t y = 0; y < height; ++y) {
+        const uint8_t *src = pixels + (size_t)y * stride;
+        uint8_t *dst = raw + y * row_size;
+        *dst++ = 0;
+        for (uint32_t x = 0; x < width; ++x) {
+            /* XRGB8888 is stored as B, G, R, X in memory */
+            *dst++ = src[4 * x + 2];
+            *dst++ = src[4 * x + 1];
+            *dst++ = src[4 * x];
+        }
+    }
+
+    bool success = false;
+    if (compress2(compressed, &compressed_size, raw, raw_size, Z_DEFAULT_COMPRESSION) != Z_OK) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not compress %s", path);
+        goto end;
+    }
+
+    FILE *file = fopen(path, "we");
+    if (!file) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not open %s for writing", path);
+        goto end;
+    }
+
+    static const uint8_t signature[] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    uint8_t ihdr[13];
+    put_u32(ihdr, width);
+    put_u32(ihdr + 4, height);
+    ihdr[8] = 8;  /* Bit depth */
+    ihdr[9] = 2;  /* Color type: truecolor */
+    ihdr[10] = 0; /* Compression method: deflate */
+    ihdr[11] = 0; /* Filter method: adaptive */
+    ihdr[12] = 0; /* Interlace method: none */
+
+    success = fwrite(signature, 1, sizeof(signature), file) == sizeof(signature)
+        && write_chunk(file, "IHDR", ihdr, sizeof(ihdr))
+        && write_chunk(file, "IDAT", compressed, compressed_size)
+        && write_chunk(file, "IEND", NULL, 0);
+
+    if (fclose(file) != 0 || !success) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not write %s", path);
+        success = false;
+    }
+
+end:
+    free(raw);
+    free(compressed);
+    return success;
+}
@@ -0,0 +1,26 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_PNG_H
+#define BB_PNG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Write XRGB8888 pixels to an RGB PNG file.
+ *
+ * @param path path of the file to write
+ * @param pixels pixel data
+ * @param width number of pixels per row
+ * @param height number of rows
+ * @param stride number of bytes per row in pixels
+ * @return true on success, false otherwise
+ */
+bool bb_png_write_xrgb8888(const char *path, const uint8_t *pixels, uint32_t width, uint32_t height,
+    uint32_t stride);
+
+#endif /* BB_PNG_H */
@@ -0,0 +1,60 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "results.h"
+
+#include "buffyboard.h"
+
+#include "../shared/log.h"
+
+#include <stdarg.h>
+
+
+/**
+ * Public functions
+ */
+
+bool bb_results_open(bb_results *results, const char *path, int iterations, const char *fields) {
+    results->path = path;
+    results->file = path ? fopen(path, "we") : stdout;
+    results->is_first = true;
+
+    if (!results->file) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not open %s for writing", path);
+        return false;
+    }
+
+    fprintf(results->file, "{\n  \"version\":\"%s\",\n", PROJECT_VERSION);
+    if (fields) {
+        fprintf(results->file, "  %s,\n", fields);
+    }
+    fprintf(results->file, "  \"iterations\":%d,\n  \"results\":[", iterations);
+
+    return true;
+}
+
+void bb_results_add(bb_results *results, const char *format, ...) {
+    fprintf(results->file, "%s\n    {", results->is_first ? "" : ",");
+
+    va_list args;
+    va_start(args, format);
+    vfprintf(results->file, format, args);
+    va_end(args);
+
+    fprintf(results->file, "}");
+    results->is_first = false;
+}
+
+bool bb_results_close(bb_results *results) {
+    fprintf(results->file, "\n  ]\n}\n");
+
+    if (results->path && fclose(results->file) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not write benchmark results to %s", results->path);
+        return false;
+    }
+
+    return true;
+}
@@ -0,0 +1,52 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_RESULTS_H
+#define BB_RESULTS_H
+
+#include <stdbool.h>
+#include <stdio.h>
+
+/**
+ * JSON results file of a benchmark
+ */
+typedef struct {
+    /* Path of the file or NULL when writing to STDOUT */
+    const char *path;
+    /* Open file */
+    FILE *file;
+    /* True until the first result was added */
+    bool is_first;
+} bb_results;
+
+/**
+ * Open a results file and write the header with the version and the number of iterations.
+ *
+ * @param results results file to initialise
+ * @param path path of the file to write to or NULL for STDOUT
+ * @param iterations number of timed iterations behind each result
+ * @param fields additional JSON members for the header (e.g. "\"layout\":\"terminal/us\"") or NULL
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_results_open(bb_results *results, const char *path, int iterations, const char *fields);
+
+/**
+ * Add a result as a JSON object.
+ *
+ * @param results results file
+ * @param format printf format string for the members of the object without the enclosing braces
+ */
+void bb_results_add(bb_results *results, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+/**
+ * Write the footer and close the results file.
+ *
+ * @param results results file
+ * @return true if the file was written successfully, false otherwise
+ */
+bool bb_results_close(bb_results *results);
+
+#endif /* BB_RESULTS_H */
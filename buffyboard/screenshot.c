@@ -0,0 +1,253 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "screenshot.h"
+
+#include "headless.h"
+#include "keyboard.h"
+#include "layout.h"
+#include "png.h"
+
+#include "lvgl/lvgl.h"
+
+#include "../shared/log.h"
+#include "../shared/theme.h"
+#include "../shared/themes.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+
+/**
+ * Static variables
+ */
+
+static bool is_lvgl_initialised = false;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Discard key events emitted by the keyboard.
+ *
+ * @param scancode the key's scancode
+ * @param pressed true for a key down event, false for a key up event
+ */
+static void key_cb(int scancode, bool pressed);
+
+/**
+ * Render a single screenshot.
+ *
+ * @param dir output directory
+ * @param theme theme to render
+ * @param res resolution to render at
+ * @return true on success, false otherwise
+ */
+static bool render(const char *dir, const bbx_theme *theme, const bb_headless_resolution *res);
+
+/**
+ * Render every num_workers-th screenshot starting with the one at index worker.
+ *
+ * @param dir output directory
+ * @param num_jobs total number of screenshots
+ * @param worker index of the worker
+ * @param num_workers total number of workers
+ * @return true on success, false otherwise
+ */
+static bool render_share(const char *dir, int num_jobs, int worker, int num_workers);
+
+/**
+ * Compare two themes by name for sorting.
+ *
+ * @param a pointer to the first theme
+ * @param b pointer to the second theme
+ * @return negative, zero or positive value as required by qsort
+ */
+static int compare_themes(const void *a, const void *b);
+
+/**
+ * Write a README.md listing all screenshots grouped by theme.
+ *
+ * @param dir output directory
+ * @param num_themes number of themes
+ * @return true on success, false otherwise
+ */
+static bool write_readme(const char *dir, int num_themes);
+
+
+/**
+ * Static functions
+ */
+
+static void key_cb(int scancode, bool pressed) {
+}
+
+static bool render(const char *dir, const bbx_theme *theme, const bb_headless_resolution *res) {
+    lv_display_t *disp = bb_headless_display_create(res->width, res->height);
+    if (!disp) {
+        return false;
+    }
+
+    bbx_theme_apply(theme);
+
+    /* Leave the terminal's part of the screen black, like an empty console */
+    lv_obj_t *screen = lv_display_get_screen_active(disp);
+    lv_obj_set_style_bg_color(screen, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(screen, LV_OPA_COVER, 0);
+
+    int32_t height = res->height / bb_keyboard_height_denominator(res->width, res->height);
+    lv_obj_t *container = lv_obj_create(screen);
+    lv_obj_remove_style_all(container);
+    lv_obj_set_pos(container, 0, res->height - height);
+    lv_obj_set_size(container, res->width, height);
+    bb_keyboard_create(container, bb_layout_default_name, key_cb);
+
+    lv_refr_now(disp);
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/%s-%dx%d.png", dir, theme->name, res->width, res->height);
+    uint32_t stride = 0;
+    const uint8_t *pixels = bb_headless_display_get_pixels(disp, &stride);
+    bool success = bb_png_write_xrgb8888(path, pixels, res->width, res->height, stride);
+
+    bb_headless_display_delete(disp);
+
+    if (success) {
+        bbx_log(BBX_LOG_LEVEL_VERBOSE, "Wrote %s", path);
+    }
+    return success;
+}
+
+static bool render_share(const char *dir, int num_jobs, int worker, int num_workers) {
+    if (!is_lvgl_initialised) {
+        lv_init();
+        lv_log_register_print_cb(bbx_log_print_cb);
+        is_lvgl_initialised = true;
+    }
+
+    bool success = true;
+    for (int job = worker; job < num_jobs; job += num_workers) {
+        const bbx_theme *theme = bbx_themes_themes[job / bb_headless_num_resolutions];
+        if (!render(dir, theme, &bb_headless_resolutions[job % bb_headless_num_resolutions])) {
+            success = false;
+        }
+    }
+    return success;
+}
+
+static int compare_themes(const void *a, const void *b) {
+    return strcmp((*(const bbx_theme * const *)a)->name, (*(const bbx_theme * const *)b)->name);
+}
+
+static bool write_readme(const char *dir, int num_themes) {
+    const bbx_theme **themes = malloc(num_themes * sizeof(bbx_theme *));
+    if (!themes) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for README");
+        return false;
+    }
+    for (int i = 0; i < num_themes; ++i) {
+        themes[i] = bbx_themes_themes[i];
+    }
+    qsort(themes, num_themes, sizeof(bbx_theme *), compare_themes);
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/README.md", dir);
+    FILE *file = fopen(path, "we");
+    if (!file) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not open %s for writing", path);
+        free(themes);
+        return false;
+    }
+
+    fprintf(file, "# Buffyboard themes\n");
+    for (int i = 0; i < num_themes; ++i) {
+        fprintf(file, "\n## %s\n\n", themes[i]->name);
+        for (int r = 0; r < bb_headless_num_resolutions; ++r) {
+            const bb_headless_resolution *res = &bb_headless_resolutions[r];
+            fprintf(file, "<img src=\"%s-%dx%d.png\" alt=\"%dx%d\" height=\"300\"/>\n",
+                themes[i]->name, res->width, res->height, res->width, res->height);
+        }
+    }
+    free(themes);
+
+    if (fclose(file) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not write %s", path);
+        return false;
+    }
+    return true;
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_screenshot_run(const char *dir) {
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not create %s: %s", dir, strerror(errno));
+        return false;
+    }
+
+    int num_themes = 0;
+    while (bbx_themes_themes[num_themes] != NULL) {
+        ++num_themes;
+    }
+
+    /* LVGL keeps global state, so render in separate processes rather than threads */
+    int num_jobs = num_themes * bb_headless_num_resolutions;
+    long num_workers = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_workers < 1) {
+        num_workers = 1;
+    } else if (num_workers > num_jobs) {
+        num_workers = num_jobs;
+    }
+
+    bool success = true;
+    pid_t *pids = calloc(num_workers, sizeof(pid_t));
+    if (!pids) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate memory for worker processes");
+        return false;
+    }
+
+    for (int i = 0; i < num_workers; ++i) {
+        pids[i] = (num_workers > 1) ? fork() : -1;
+        if (pids[i] == 0) {
+            _exit(render_share(dir, num_jobs, i, num_workers) ? EXIT_SUCCESS : EXIT_FAILURE);
+        }
+    }
+
+    /* Render the share of any worker that couldn't be started here */
+    for (int i = 0; i < num_workers; ++i) {
+        if (pids[i] < 0 && !render_share(dir, num_jobs, i, num_workers)) {
+            success = false;
+        }
+    }
+
+    for (int i = 0; i < num_workers; ++i) {
+        int status = 0;
+        if (pids[i] > 0 && (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status)
+                || WEXITSTATUS(status) != EXIT_SUCCESS)) {
+            success = false;
+        }
+    }
+    free(pids);
+
+    if (!write_readme(dir, num_themes)) {
+        success = false;
+    }
+
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Rendered %d screenshots with %ld processes", num_jobs, num_workers);
+    return success;
+}
@@ -0,0 +1,22 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_SCREENSHOT_H
+#define BB_SCREENSHOT_H
+
+#include <stdbool.h>
+
+/**
+ * Render the keyboard off-screen with every theme at every screenshot resolution and write the results as PNG
+ * files together with a README.md gallery. The work is spread over one process per CPU core. LVGL must not
+ * have been initialised beforehand.
+ *
+ * @param dir directory to write the screenshots into, created if necessary
+ * @return true on success, false otherwise
+ */
+bool bb_screenshot_run(const char *dir);
+
+#endif /* BB_SCREENSHOT_H */
@@ -0,0 +1,25 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+/* Development tool that renders the screenshot gallery outside of the installed daemon */
+
+#include "screenshot.h"
+
+#include <stdio.h>
+
+
+/**
+ * Main
+ */
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s DIR\n", argv[0]);
+        return 1;
+    }
+
+    return bb_screenshot_run(argv[1]) ? 0 : 1;
+}
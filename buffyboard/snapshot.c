@@ -0,0 +1,266 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "snapshot.h"
+
+#include "../shared/log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <linux/fb.h>
+
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+
+/**
+ * Defines
+ */
+
+/* Directory for storing snapshots */
+#define SNAPSHOT_DIR "/var/cache/buffyboard"
+
+/* Identifier at the start of every snapshot file */
+#define SNAPSHOT_MAGIC "BBSNAP1"
+
+/* Maximum length of a snapshot key including the terminating null byte */
+#define MAX_KEY_LENGTH 256
+
+
+/**
+ * Static types
+ */
+
+/* Header of a snapshot file. The pixel rows follow directly after it. */
+typedef struct {
+    /* SNAPSHOT_MAGIC */
+    char magic[8];
+    /* Full key the snapshot was saved with */
+    char key[MAX_KEY_LENGTH];
+    /* Position and size of the saved area in physical framebuffer pixels */
+    uint32_t x;
+    uint32_t y;
+    uint32_t width;
+    uint32_t height;
+    /* Number of bytes per pixel */
+    uint32_t bytes_per_pixel;
+} snapshot_header;
+
+
+/**
+ * Static variables
+ */
+
+static int fb_fd = -1;
+static struct fb_var_screeninfo vinfo;
+static struct fb_fix_screeninfo finfo;
+static char full_key[MAX_KEY_LENGTH];
+static char path[PATH_MAX];
+static snapshot_header header;
+static bool is_painted = false;
+static bool is_saved = false;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Compute the byte offset of a pixel in the framebuffer, taking panning into account.
+ *
+ * @param x horizontal position
+ * @param y vertical position
+ * @return offset in bytes
+ */
+static off_t pixel_offset(uint32_t x, uint32_t y);
+
+/**
+ * Copy a snapshot file into the framebuffer if it is valid.
+ *
+ * @return true if the snapshot was painted, false otherwise
+ */
+static bool paint_file(void);
+
+/**
+ * Save the saved area of the framebuffer to the snapshot file.
+ */
+static void save_file(void);
+
+/**
+ * Handle LV_EVENT_REFR_READY events from the display.
+ *
+ * @param event the event object
+ */
+static void refr_ready_cb(lv_event_t *event);
+
+
+/**
+ * Static functions
+ */
+
+static off_t pixel_offset(uint32_t x, uint32_t y) {
+    return (off_t)(vinfo.yoffset + y) * finfo.line_length + (off_t)(vinfo.xoffset + x) * (vinfo.bits_per_pixel / 8);
+}
+
+static bool paint_file(void) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(snapshot_header)) {
+        close(fd);
+        return false;
+    }
+
+    uint8_t *data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (data == MAP_FAILED) {
+        return false;
+    }
+
+    bool result = false;
+    const snapshot_header *file_header = (const snapshot_header *)data;
+    size_t row_size = (size_t)file_header->width * file_header->bytes_per_pixel;
+
+    /* Treat anything unexpected as a cache miss. The file is replaced after the first frame then. */
+    if (memcmp(file_header->magic, SNAPSHOT_MAGIC, sizeof(file_header->magic)) != 0
+            || strncmp(file_header->key, full_key, sizeof(file_header->key)) != 0
+            || file_header->bytes_per_pixel != vinfo.bits_per_pixel / 8
+            || file_header->width > vinfo.xres || file_header->x > vinfo.xres - file_header->width
+            || file_header->height > vinfo.yres || file_header->y > vinfo.yres - file_header->height
+            || (off_t)(sizeof(snapshot_header) + row_size * file_header->height) != st.st_size) {
+        goto out;
+    }
+
+    const uint8_t *row = data + sizeof(snapshot_header);
+    for (uint32_t y = 0; y < file_header->height; ++y, row += row_size) {
+        if (pwrite(fb_fd, row, row_size, pixel_offset(file_header->x, file_header->y + y)) != (ssize_t)row_size) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "Could not paint snapshot: %s", strerror(errno));
+            goto out;
+        }
+    }
+
+    result = true;
+
+out:
+    munmap(data, st.st_size);
+    return result;
+}
+
+static void save_file(void) {
+    size_t row_size = (size_t)header.width * header.bytes_per_pixel;
+    uint8_t *row = malloc(row_size);
+    if (!row) {
+        return;
+    }
+
+    char tmp_path[PATH_MAX + 4];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", path);
+
+    mkdir(SNAPSHOT_DIR, 0755);
+    FILE *file = fopen(tmp_path, "we");
+    if (!file) {
+        bbx_log(BBX_LOG_LEVEL_VERBOSE, "Could not save snapshot: %s", strerror(errno));
+        free(row);
+        return;
+    }
+
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    for (uint32_t y = 0; success && y < header.height; ++y) {
+        success = pread(fb_fd, row, row_size, pixel_offset(header.x, header.y + y)) == (ssize_t)row_size
+            && fwrite(row, row_size, 1, file) == 1;
+    }
+    success = (fclose(file) == 0) && success;
+    free(row);
+
+    /* Replace atomically so that a concurrently starting instance never sees a partial file */
+    if (!success || rename(tmp_path, path) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not save snapshot %s", path);
+        unlink(tmp_path);
+        return;
+    }
+
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Saved snapshot %s", path);
+}
+
+static void refr_ready_cb(lv_event_t *event) {
+    if (is_saved) {
+        return;
+    }
+    is_saved = true;
+
+    save_file();
+    close(fb_fd);
+    fb_fd = -1;
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_snapshot_paint(const char *key) {
+    fb_fd = open("/dev/fb0", O_RDWR | O_CLOEXEC);
+    if (fb_fd < 0) {
+        return false;
+    }
+
+    if (ioctl(fb_fd, FBIOGET_VSCREENINFO, &vinfo) != 0 || ioctl(fb_fd, FBIOGET_FSCREENINFO, &finfo) != 0
+            || vinfo.bits_per_pixel % 8 != 0) {
+        close(fb_fd);
+        fb_fd = -1;
+        return false;
+    }
+
+    /* The framebuffer mode is part of the key so that mode changes invalidate the snapshot */
+    snprintf(full_key, sizeof(full_key), "%s fb=%ux%u/%u/%u", key, vinfo.xres, vinfo.yres,
+        vinfo.bits_per_pixel, finfo.line_length);
+
+    /* FNV-1a hash of the key for the file name */
+    uint64_t hash = 0xcbf29ce484222325ull;
+    for (const char *c = full_key; *c; ++c) {
+        hash = (hash ^ (uint8_t)*c) * 0x100000001b3ull;
+    }
+    snprintf(path, sizeof(path), "%s/%016llx.snapshot", SNAPSHOT_DIR, (unsigned long long)hash);
+
+    is_painted = paint_file();
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, is_painted ? "Painted snapshot %s" : "No usable snapshot %s", path);
+    return is_painted;
+}
+
+void bb_snapshot_save_after_first_frame(lv_display_t *disp, const lv_area_t *area) {
+    if (fb_fd < 0) {
+        return;
+    }
+
+    if (is_painted || area->x1 < 0 || area->y1 < 0 || (uint32_t)area->x2 >= vinfo.xres
+            || (uint32_t)area->y2 >= vinfo.yres) {
+        close(fb_fd);
+        fb_fd = -1;
+        return;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+    snprintf(header.key, sizeof(header.key), "%s", full_key);
+    header.x = area->x1;
+    header.y = area->y1;
+    header.width = lv_area_get_width(area);
+    header.height = lv_area_get_height(area);
+    header.bytes_per_pixel = vinfo.bits_per_pixel / 8;
+
+    lv_display_add_event_cb(disp, refr_ready_cb, LV_EVENT_REFR_READY, NULL);
+}
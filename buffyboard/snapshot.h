@@ -0,0 +1,31 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_SNAPSHOT_H
+#define BB_SNAPSHOT_H
+
+#include "lvgl/lvgl.h"
+
+#include <stdbool.h>
+
+/**
+ * Look up a snapshot of the first frame for the current framebuffer mode and the given key and, if one
+ * exists, copy it into /dev/fb0. Must be called before the framebuffer display is created.
+ *
+ * @param key string identifying everything that affects the rendered keyboard (theme, geometry, ...)
+ * @return true if a snapshot was painted, false otherwise
+ */
+bool bb_snapshot_paint(const char *key);
+
+/**
+ * Save the first frame of a display as a snapshot unless one was already painted on startup.
+ *
+ * @param disp display to wait for
+ * @param area area to save in physical (unrotated) framebuffer coordinates
+ */
+void bb_snapshot_save_after_first_frame(lv_display_t *disp, const lv_area_t *area);
+
+#endif /* BB_SNAPSHOT_H */
@@ -0,0 +1,282 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "soak.h"
+
+#include "clock.h"
+#include "headless.h"
+#include "keyboard.h"
+#include "layout.h"
+
+#include "lvgl/lvgl.h"
+
+#include "../shared/log.h"
+
+#include <dirent.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#include <linux/input.h>
+
+
+/**
+ * Defines
+ */
+
+/* Number of samples taken over the whole run */
+#define NUM_SAMPLES 20
+
+/* Resident memory may grow by this many bytes over the baseline before it counts as drift */
+#define MAX_RSS_GROWTH (1024 * 1024)
+
+/* LVGL pool usage may grow by this many bytes over the baseline before it counts as drift */
+#define MAX_POOL_GROWTH (4 * 1024)
+
+/* Mean per-key latency may grow by this many percent over the baseline before it counts as drift */
+#define MAX_LATENCY_GROWTH_PCT 50
+
+/* Latency growth in µs below which differences are treated as noise */
+#define MIN_LATENCY_GROWTH 10
+
+/* Seed of the random number generator, fixed so that failures can be reproduced */
+#define SEED 0x2545f4914f6cdd1dULL
+
+
+/**
+ * Static types
+ */
+
+/* Resource usage at one point in time */
+typedef struct {
+    /* Resident set size in bytes */
+    long rss;
+    /* Bytes in use in LVGL's pool or 0 with the system allocator */
+    uint32_t pool_used;
+    /* Number of open file descriptors */
+    int fds;
+    /* Mean latency per key press since the previous sample in µs */
+    uint64_t latency;
+} sample;
+
+
+/**
+ * Static variables
+ */
+
+static bool is_key_down[KEY_MAX + 1];
+static long num_key_events = 0;
+static long num_key_errors = 0;
+static uint64_t rng_state = SEED;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Get the next pseudo-random number.
+ *
+ * @return random number
+ */
+static uint64_t next_random(void);
+
+/**
+ * Record key events in place of the uinput device and check that every key is pressed before it's released.
+ *
+ * @param scancode the key's scancode
+ * @param pressed true for a key down event, false for a key up event
+ */
+static void key_cb(int scancode, bool pressed);
+
+/**
+ * Press and release a key like the button matrix does when it's tapped.
+ *
+ * @param keyboard keyboard widget of the current layer
+ * @param btn_id button index corresponding to the key
+ */
+static void tap(lv_obj_t *keyboard, uint32_t btn_id);
+
+/**
+ * Count the open file descriptors of the process.
+ *
+ * @return number of file descriptors or -1 on failure
+ */
+static int count_fds(void);
+
+/**
+ * Take a sample of the current resource usage.
+ *
+ * @param s pointer for writing the sample into
+ * @param latency mean latency per key press since the previous sample in µs
+ */
+static void take_sample(sample *s, uint64_t latency);
+
+
+/**
+ * Static functions
+ */
+
+static uint64_t next_random(void) {
+    /* xorshift64* */
+    rng_state ^= rng_state >> 12;
+    rng_state ^= rng_state << 25;
+    rng_state ^= rng_state >> 27;
+    return rng_state * 0x2545f4914f6cdd1dULL;
+}
+
+static void key_cb(int scancode, bool pressed) {
+    ++num_key_events;
+    if (scancode < 0 || scancode > KEY_MAX || is_key_down[scancode] == pressed) {
+        ++num_key_errors;
+        return;
+    }
+    is_key_down[scancode] = pressed;
+}
+
+static void tap(lv_obj_t *keyboard, uint32_t btn_id) {
+    /* Mirror the button matrix's release handling, which toggles checkable keys before reporting the change */
+    if (lv_buttonmatrix_has_button_ctrl(keyboard, btn_id, LV_BUTTONMATRIX_CTRL_CHECKABLE)) {
+        if (lv_buttonmatrix_has_button_ctrl(keyboard, btn_id, LV_BUTTONMATRIX_CTRL_CHECKED)) {
+            lv_buttonmatrix_clear_button_ctrl(keyboard, btn_id, LV_BUTTONMATRIX_CTRL_CHECKED);
+        } else {
+            lv_buttonmatrix_set_button_ctrl(keyboard, btn_id, LV_BUTTONMATRIX_CTRL_CHECKED);
+        }
+    }
+    lv_buttonmatrix_set_selected_button(keyboard, btn_id);
+    lv_obj_send_event(keyboard, LV_EVENT_VALUE_CHANGED, &btn_id);
+}
+
+static int count_fds(void) {
+    DIR *dir = opendir("/proc/self/fd");
+    if (!dir) {
+        return -1;
+    }
+
+    int count = 0;
+    while (readdir(dir)) {
+        ++count;
+    }
+    closedir(dir);
+
+    /* Don't count ".", ".." and the directory itself */
+    return count - 3;
+}
+
+static void take_sample(sample *s, uint64_t latency) {
+    s->rss = 0;
+    FILE *statm = fopen("/proc/self/statm", "re");
+    if (statm) {
+        long pages = 0;
+        if (fscanf(statm, "%*d %ld", &pages) == 1) {
+            s->rss = pages * sysconf(_SC_PAGESIZE);
+        }
+        fclose(statm);
+    }
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    s->pool_used = mem.total_size - mem.free_size;
+
+    s->fds = count_fds();
+    s->latency = latency;
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_soak_run(long num_presses) {
+    const bb_headless_resolution *res = &bb_headless_resolutions[0];
+    int32_t height = res->height / bb_keyboard_height_denominator(res->width, res->height);
+    lv_display_t *disp = bb_headless_display_create(res->width, height);
+    if (!disp) {
+        return false;
+    }
+
+    lv_obj_t *keyboard = bb_keyboard_create(lv_display_get_screen_active(disp), bb_layout_default_name, key_cb);
+    lv_refr_now(disp);
+
+    long sample_interval = (num_presses >= NUM_SAMPLES) ? num_presses / NUM_SAMPLES : 1;
+    long num_layer_switches = 0;
+    uint64_t window_time = 0;
+    sample baseline = { 0 };
+    sample current = { 0 };
+
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Soaking with %ld key presses", num_presses);
+
+    for (long i = 1; i <= num_presses; ++i) {
+        const bb_layout_layer *layer = &bb_layout_get_current()->layers[bb_layout_get_current_layer_index()];
+        uint32_t btn_id = next_random() % layer->num_keys;
+        bool is_layer_switcher = bb_layout_is_layer_switcher(btn_id);
+
+        uint64_t start = bb_clock_now();
+        tap(bb_keyboard_get_active_layer(keyboard), btn_id);
+        lv_refr_now(disp);
+        window_time += bb_clock_now() - start;
+
+        if (is_layer_switcher) {
+            ++num_layer_switches;
+        }
+
+        if (i % sample_interval == 0) {
+            take_sample(&current, window_time / sample_interval);
+            window_time = 0;
+
+            bbx_log(BBX_LOG_LEVEL_ERROR, "%ld presses: RSS %ld KiB, LVGL pool %u bytes, %d fds, %llu µs per key",
+                i, current.rss / 1024, current.pool_used, current.fds, (unsigned long long)current.latency);
+
+            /* The first window includes allocations that only happen once, so compare against the second */
+            if (i / sample_interval == 2 || num_presses < 2 * sample_interval) {
+                baseline = current;
+            }
+        }
+    }
+
+    /* Nothing may be left pressed once all modifiers are released */
+    bb_keyboard_release_modifiers(keyboard);
+    long num_stuck_keys = 0;
+    for (int i = 0; i <= KEY_MAX; ++i) {
+        if (is_key_down[i]) {
+            ++num_stuck_keys;
+        }
+    }
+
+    bbx_log(BBX_LOG_LEVEL_ERROR, "%ld key events, %ld layer switches", num_key_events, num_layer_switches);
+
+    bool success = true;
+    if (num_key_errors > 0 || num_stuck_keys > 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: %ld unbalanced key events, %ld stuck keys", num_key_errors,
+            num_stuck_keys);
+        success = false;
+    }
+    if (current.rss > baseline.rss + MAX_RSS_GROWTH) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: RSS grew from %ld to %ld KiB", baseline.rss / 1024, current.rss / 1024);
+        success = false;
+    }
+    if (current.pool_used > baseline.pool_used + MAX_POOL_GROWTH) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: LVGL pool usage grew from %u to %u bytes", baseline.pool_used,
+            current.pool_used);
+        success = false;
+    }
+    if (current.fds != baseline.fds) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: open file descriptors changed from %d to %d", baseline.fds, current.fds);
+        success = false;
+    }
+    if (current.latency * 100 > baseline.latency * (100 + MAX_LATENCY_GROWTH_PCT)
+            && current.latency > baseline.latency + MIN_LATENCY_GROWTH) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: latency per key grew from %llu to %llu µs",
+            (unsigned long long)baseline.latency, (unsigned long long)current.latency);
+        success = false;
+    }
+
+    if (success) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "PASS");
+    }
+
+    bb_headless_display_delete(disp);
+    return success;
+}
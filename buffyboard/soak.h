@@ -0,0 +1,22 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_SOAK_H
+#define BB_SOAK_H
+
+#include <stdbool.h>
+
+/**
+ * Drive random key presses, modifier toggles and layer switches through an off-screen keyboard while
+ * periodically sampling resident memory, LVGL pool usage, open file descriptors and per-key latency. LVGL must
+ * have been initialised beforehand.
+ *
+ * @param num_presses number of key presses to simulate
+ * @return true if no stuck keys were detected and no sample drifted from the baseline, false otherwise
+ */
+bool bb_soak_run(long num_presses);
+
+#endif /* BB_SOAK_H */
@@ -0,0 +1,129 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "startup_trace.h"
+
+#include "clock.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+
+/**
+ * Defines
+ */
+
+/* Maximum number of phases that can be recorded */
+#define MAX_PHASES 32
+
+
+/**
+ * Static types
+ */
+
+/* Recorded startup phase */
+typedef struct {
+    /* Name of the phase */
+    const char *name;
+    /* Start time in µs relative to the trace start */
+    uint64_t start;
+    /* End time in µs relative to the trace start, equal to the start time while the phase is running */
+    uint64_t end;
+} trace_phase;
+
+
+/**
+ * Static variables
+ */
+
+static bool is_enabled = false;
+static uint64_t trace_start = 0;
+static trace_phase phases[MAX_PHASES];
+static int num_phases = 0;
+static bool is_reported = false;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Handle LV_EVENT_REFR_READY events from the display.
+ *
+ * @param event the event object
+ */
+static void refr_ready_cb(lv_event_t *event);
+
+
+/**
+ * Static functions
+ */
+
+static void refr_ready_cb(lv_event_t *event) {
+    if (is_reported) {
+        return;
+    }
+    is_reported = true;
+
+    uint64_t first_frame = bb_clock_now() - trace_start;
+
+    pthread_mutex_lock(&lock);
+    fprintf(stderr, "Startup trace (ms since start):\n");
+    fprintf(stderr, "  %-24s %9s %9s %9s\n", "phase", "start", "end", "duration");
+    for (int i = 0; i < num_phases; ++i) {
+        fprintf(stderr, "  %-24s %9.1f %9.1f %9.1f\n", phases[i].name, phases[i].start / 1000.0,
+            phases[i].end / 1000.0, (phases[i].end - phases[i].start) / 1000.0);
+    }
+    fprintf(stderr, "  %-24s %29.1f\n", "first frame", first_frame / 1000.0);
+    pthread_mutex_unlock(&lock);
+}
+
+
+/**
+ * Public functions
+ */
+
+void bb_startup_trace_enable(void) {
+    trace_start = bb_clock_now();
+    is_enabled = true;
+}
+
+int bb_startup_trace_begin(const char *name) {
+    if (!is_enabled) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&lock);
+    int index = -1;
+    if (num_phases < MAX_PHASES) {
+        index = num_phases++;
+        phases[index].name = name;
+        phases[index].start = bb_clock_now() - trace_start;
+        phases[index].end = phases[index].start;
+    }
+    pthread_mutex_unlock(&lock);
+
+    return index;
+}
+
+void bb_startup_trace_end(int phase) {
+    if (phase < 0) {
+        return;
+    }
+
+    pthread_mutex_lock(&lock);
+    phases[phase].end = bb_clock_now() - trace_start;
+    pthread_mutex_unlock(&lock);
+}
+
+void bb_startup_trace_report_after_first_frame(lv_display_t *disp) {
+    if (is_enabled) {
+        lv_display_add_event_cb(disp, refr_ready_cb, LV_EVENT_REFR_READY, NULL);
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_STARTUP_TRACE_H
+#define BB_STARTUP_TRACE_H
+
+#include "lvgl/lvgl.h"
+
+/**
+ * Start recording startup phases. Phases are only recorded if this was called. All timings are reported
+ * relative to the point in time at which this function is called.
+ */
+void bb_startup_trace_enable(void);
+
+/**
+ * Record the start of a startup phase. Phases can overlap and may be recorded from any thread.
+ *
+ * @param name name of the phase (must stay valid until the report has been printed)
+ * @return phase handle for passing to bb_startup_trace_end
+ */
+int bb_startup_trace_begin(const char *name);
+
+/**
+ * Record the end of a startup phase.
+ *
+ * @param phase phase handle returned by bb_startup_trace_begin
+ */
+void bb_startup_trace_end(int phase);
+
+/**
+ * Print the recorded phases once the display has rendered its first frame.
+ *
+ * @param disp display to wait for
+ */
+void bb_startup_trace_report_after_first_frame(lv_display_t *disp);
+
+#endif /* BB_STARTUP_TRACE_H */
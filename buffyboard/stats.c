@@ -0,0 +1,211 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "stats.h"
+
+#include "clock.h"
+
+#include "../shared/log.h"
+
+#include <stdio.h>
+
+#include <sys/resource.h>
+
+
+/**
+ * Static types
+ */
+
+/* Statistics collected over one logging interval */
+typedef struct {
+    /* Number of refreshes that flushed at least one area */
+    uint32_t frames;
+    /* Total time spent refreshing in µs, including flushing */
+    uint64_t refresh_time;
+    /* Time spent flushing in µs */
+    uint64_t flush_time;
+    /* Number of flushed areas */
+    uint32_t flushes;
+    /* Number of emitted key events */
+    uint32_t key_events;
+} interval_stats;
+
+/* Rates derived from the statistics of an interval */
+typedef struct {
+    /* Frames per second */
+    double fps;
+    /* Mean render time per frame in ms, excluding flushing */
+    double render_ms;
+    /* Mean flush time per frame in ms */
+    double flush_ms;
+    /* CPU usage in percent of one core */
+    double cpu_pct;
+    /* Key events per second */
+    double key_events_per_s;
+} interval_rates;
+
+
+/**
+ * Static variables
+ */
+
+static bool is_enabled = false;
+static interval_stats current;
+static uint64_t interval_start = 0;
+static uint64_t cpu_start = 0;
+static uint64_t refresh_start = 0;
+static uint64_t flush_start = 0;
+static uint32_t flushes_at_refresh_start = 0;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Get the CPU time consumed by the process so far.
+ *
+ * @return CPU time in µs
+ */
+static uint64_t cpu_time(void);
+
+/**
+ * Handle refresh and flush events from the display.
+ *
+ * @param event the event object
+ */
+static void display_event_cb(lv_event_t *event);
+
+/**
+ * Derive rates from the statistics of the current interval.
+ *
+ * @param end end of the interval in µs
+ * @param cpu_end CPU time at the end of the interval in µs
+ * @param rates pointer for writing the rates into
+ */
+static void compute_rates(uint64_t end, uint64_t cpu_end, interval_rates *rates);
+
+/**
+ * Log and reset the statistics of the current interval.
+ *
+ * @param timer the timer object
+ */
+static void log_timer_cb(lv_timer_t *timer);
+
+
+/**
+ * Static functions
+ */
+
+static uint64_t cpu_time(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return (uint64_t)(usage.ru_utime.tv_sec + usage.ru_stime.tv_sec) * 1000000
+        + (uint64_t)(usage.ru_utime.tv_usec + usage.ru_stime.tv_usec);
+}
+
+static void display_event_cb(lv_event_t *event) {
+    switch (lv_event_get_code(event)) {
+        case LV_EVENT_REFR_START:
+            refresh_start = bb_clock_now();
+            flushes_at_refresh_start = current.flushes;
+            break;
+        case LV_EVENT_REFR_READY:
+            /* The refresh timer runs periodically even if nothing needs to be redrawn */
+            if (current.flushes != flushes_at_refresh_start) {
+                current.frames++;
+                current.refresh_time += bb_clock_now() - refresh_start;
+            }
+            break;
+        case LV_EVENT_FLUSH_START:
+            flush_start = bb_clock_now();
+            break;
+        case LV_EVENT_FLUSH_FINISH:
+            current.flushes++;
+            current.flush_time += bb_clock_now() - flush_start;
+            break;
+        default:
+            break;
+    }
+}
+
+static void compute_rates(uint64_t end, uint64_t cpu_end, interval_rates *rates) {
+    double seconds = (end - interval_start) / 1000000.0;
+    if (seconds <= 0) {
+        *rates = (interval_rates){ 0 };
+        return;
+    }
+
+    rates->fps = current.frames / seconds;
+    rates->render_ms = current.frames ? (current.refresh_time - current.flush_time) / 1000.0 / current.frames : 0;
+    rates->flush_ms = current.frames ? current.flush_time / 1000.0 / current.frames : 0;
+    rates->cpu_pct = (cpu_end - cpu_start) / 10000.0 / seconds;
+    rates->key_events_per_s = current.key_events / seconds;
+}
+
+static void log_timer_cb(lv_timer_t *timer) {
+    uint64_t end = bb_clock_now();
+    uint64_t cpu_end = cpu_time();
+    interval_rates rates;
+    compute_rates(end, cpu_end, &rates);
+
+    /* Statistics were explicitly requested, so log them regardless of the verbosity */
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Stats: %.1f fps, %.2f ms render, %.2f ms flush per frame, %.1f%% CPU, %.1f key events/s",
+        rates.fps, rates.render_ms, rates.flush_ms, rates.cpu_pct, rates.key_events_per_s);
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    if (mem.total_size > 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Stats: pool %zu/%zu bytes used (%u%%), %zu bytes max, %u%% fragmentation",
+            mem.total_size - mem.free_size, mem.total_size, mem.used_pct, mem.max_used, mem.frag_pct);
+    }
+
+    interval_start = end;
+    cpu_start = cpu_end;
+    current = (interval_stats){ 0 };
+}
+
+
+/**
+ * Public functions
+ */
+
+void bb_stats_init(lv_display_t *disp, int interval) {
+    is_enabled = true;
+    interval_start = bb_clock_now();
+    cpu_start = cpu_time();
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_READY, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_FLUSH_START, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_FLUSH_FINISH, NULL);
+
+    lv_timer_create(log_timer_cb, (uint32_t)interval * 1000, NULL);
+}
+
+void bb_stats_count_key_event(void) {
+    if (is_enabled) {
+        current.key_events++;
+    }
+}
+
+void bb_stats_format(char *buf, size_t size) {
+    int len = snprintf(buf, size, "cpu_s=%.2f", cpu_time() / 1000000.0);
+
+    if (is_enabled && len >= 0 && (size_t)len < size) {
+        interval_rates rates;
+        compute_rates(bb_clock_now(), cpu_time(), &rates);
+        len += snprintf(buf + len, size - len, " fps=%.1f render_ms=%.2f flush_ms=%.2f cpu_pct=%.1f key_events_per_s=%.1f",
+            rates.fps, rates.render_ms, rates.flush_ms, rates.cpu_pct, rates.key_events_per_s);
+    }
+
+    lv_mem_monitor_t mem;
+    lv_mem_monitor(&mem);
+    if (mem.total_size > 0 && len >= 0 && (size_t)len < size) {
+        snprintf(buf + len, size - len, " pool_used=%zu pool_total=%zu pool_max=%zu frag_pct=%u",
+            mem.total_size - mem.free_size, mem.total_size, mem.max_used, mem.frag_pct);
+    }
+}
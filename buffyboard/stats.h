@@ -0,0 +1,38 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_STATS_H
+#define BB_STATS_H
+
+#include "lvgl/lvgl.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Start collecting performance statistics for a display and log them periodically.
+ *
+ * @param disp display to monitor
+ * @param interval logging interval in seconds
+ */
+void bb_stats_init(lv_display_t *disp, int interval);
+
+/**
+ * Count an emitted key event. Does nothing unless statistics are being collected.
+ */
+void bb_stats_count_key_event(void);
+
+/**
+ * Format the statistics of the current logging interval so far as space-separated key=value pairs. Frame and
+ * key event rates are only included while statistics are being collected.
+ *
+ * @param buf buffer for writing the statistics into
+ * @param size size of the buffer
+ */
+void bb_stats_format(char *buf, size_t size);
+
+#endif /* BB_STATS_H */
@@ -6,32 +6,113 @@
 
 #include "terminal.h"
 
+#include "trace.h"
+
+#include "../shared/log.h"
+
 #include <errno.h>
 #include <fcntl.h>
+#include <limits.h>
 #include <math.h>
+#include <poll.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
+#include <time.h>
 #include <unistd.h>
 
+#include <linux/kd.h>
 #include <linux/vt.h>
 
+#include <sys/eventfd.h>
 #include <sys/ioctl.h>
+#include <sys/stat.h>
+
+
+/**
+ * Defines
+ */
+
+/* Default directory for runtime state */
+#define DEFAULT_STATE_DIR "/run/buffyboard"
+
+/* Name of the file in the state directory for persisting the original sizes of resized terminals so that they
+ * can be restored after a crash */
+#define STATE_FILE_NAME "terminals"
+
+/* Interval in ms in which the eager resize worker looks for newly allocated VTs if it cannot wait for VT switches */
+#define EAGER_RESIZE_INTERVAL 250
+
+/* Signal for interrupting the eager resize worker while it waits for a VT switch */
+#define EAGER_RESIZE_WAKE_SIGNAL SIGURG
+
+/* Interval in ms in which the eager resize worker is signalled until it exits */
+#define EAGER_RESIZE_WAKE_INTERVAL 10
+
+/* Number of VTs covered by the v_state bitmask of VT_GETSTATE (bit 0 is unused) */
+#define MAX_STATE_VTS 15
 
 
 /**
  * Static variables
  */
 
+/* Operations for accessing VTs or NULL to use the real ones */
+static const bb_terminal_ops *ops = NULL;
+static char state_dir[PATH_MAX] = DEFAULT_STATE_DIR;
+static char state_file[PATH_MAX] = DEFAULT_STATE_DIR "/" STATE_FILE_NAME;
+
 static int current_fd = -1;
 static int current_vt = -1;
 static bool resized_vts[MAX_NR_CONSOLES];
+static struct winsize original_sizes[MAX_NR_CONSOLES];
+static int console_height = 0;
+static int keyboard_height = 0;
 static float height_factor = 1;
 
+/* Guards all of the above against concurrent access from the eager resize worker */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+static pthread_t eager_resize_thread;
+static bool eager_resize_running = false;
+static int eager_resize_wake_fd = -1;
+static atomic_bool eager_resize_stopping = false;
+static atomic_bool eager_resize_exited = false;
+
 
 /**
  * Static prototypes
  */
 
+/**
+ * Handle the signal used for waking the eager resize worker. The handler does nothing because the signal only
+ * serves to interrupt a pending VT_WAITEVENT.
+ *
+ * @param signum signal number
+ */
+static void eager_resize_wake_handler(int signum);
+
+/**
+ * Open a file.
+ *
+ * @param path path of the file
+ * @param flags flags as for open(2)
+ * @return file descriptor or -1 on failure
+ */
+static int default_open(const char *path, int flags);
+
+/**
+ * Perform an ioctl.
+ *
+ * @param fd file descriptor
+ * @param request request code
+ * @param arg request argument
+ * @return result as for ioctl(2)
+ */
+static int default_ioctl(int fd, unsigned long request, void *arg);
+
 /**
  * Close the current file descriptor and reopen /dev/tty0.
  * 
@@ -72,7 +153,24 @@ static bool get_terminal_size(int fd, struct winsize *size);
 static bool set_terminal_size(int fd, struct winsize *size);
 
 /**
- * Shrink the height of a terminal by the current factor.
+ * Retrieve the height of a terminal's font.
+ *
+ * @param fd TTY file descriptor
+ * @return font height in pixels or -1 if it could not be determined
+ */
+static int get_font_height(int fd);
+
+/**
+ * Compute the number of rows that fit into a given height.
+ *
+ * @param fd TTY file descriptor
+ * @param height available height in pixels
+ * @return number of rows or -1 if the terminal's font is unknown
+ */
+static int rows_for_height(int fd, int height);
+
+/**
+ * Shrink the height of a terminal so that it doesn't overlap with the keyboard.
  * 
  * @param fd TTY file descriptor
  * @return true if the operation was successful, false otherwise
@@ -80,23 +178,70 @@ static bool set_terminal_size(int fd, struct winsize *size);
 static bool shrink_terminal(int fd);
 
 /**
- * Reset the height of a terminal to the maximum.
+ * Record a VT's original size and shrink it. Must be called with the lock held.
+ *
+ * @param vt number of the VT (e.g. 7 for /dev/tty7)
+ * @param fd TTY file descriptor of the VT
+ * @return true if the operation was successful, false otherwise
+ */
+static bool record_and_shrink_terminal(int vt, int fd);
+
+/**
+ * Thread function for eagerly resizing all allocated VTs.
+ *
+ * @param data unused
+ * @return NULL
+ */
+static void *eager_resize_worker(void *data);
+
+/**
+ * Reset the height of a terminal to the maximum by probing for the largest row count that the kernel
+ * accepts. Only used if the terminal's font cannot be queried.
  * 
  * @param fd TTY file descriptor
  * @param size pointer to winsize struct for writing the final size into
  * @return true if the operation was successful, false otherwise
  */
-static bool reset_terminal(int fd, struct winsize *size);
+static bool probe_and_reset_terminal(int fd, struct winsize *size);
+
+/**
+ * Restore the size of a terminal.
+ *
+ * @param vt number of the VT (e.g. 7 for /dev/tty7)
+ * @param size size to restore
+ * @return true if the operation was successful, false otherwise
+ */
+static bool restore_terminal(int vt, struct winsize *size);
+
+/**
+ * Write the original sizes of all resized terminals to the state file or remove the file if no
+ * terminals are resized.
+ */
+static void save_state(void);
+
+/**
+ * Restore the terminal sizes recorded in a state file left behind by a previous instance that didn't
+ * exit cleanly and remove the file.
+ */
+static void restore_stale_state(void);
 
 
 /**
  * Static functions
  */
 
+static int default_open(const char *path, int flags) {
+    return open(path, flags);
+}
+
+static int default_ioctl(int fd, unsigned long request, void *arg) {
+    return ioctl(fd, request, arg);
+}
+
 static bool reopen_current_terminal(void) {
     close_current_terminal();
 
-    current_fd = open("/dev/tty0", O_RDWR | O_NOCTTY);
+    current_fd = ops->open("/dev/tty0", O_RDWR | O_NOCTTY);
 	if (current_fd < 0) {
 		perror("Could not open /dev/tty0");
 		return false;
@@ -110,13 +255,13 @@ static void close_current_terminal(void) {
         return;
     }
 
-    close(current_fd);
+    ops->close(current_fd);
     current_fd = -1;
 }
 
 static int get_active_terminal(void) {
     struct vt_stat stat;
-    if (ioctl(current_fd, VT_GETSTATE, &stat) != 0) {
+    if (ops->ioctl(current_fd, VT_GETSTATE, &stat) != 0) {
         perror("Could not retrieve current termimal state");
         return -1;
     }
@@ -124,7 +269,7 @@ static int get_active_terminal(void) {
 }
 
 static bool get_terminal_size(int fd, struct winsize *size) {
-	if (ioctl(fd, TIOCGWINSZ, size) != 0) {
+	if (ops->ioctl(fd, TIOCGWINSZ, size) != 0) {
         int errsv = errno;
         perror("Could not retrieve current terminal size");
         errno = errsv;
@@ -134,7 +279,7 @@ static bool get_terminal_size(int fd, struct winsize *size) {
 }
 
 static bool set_terminal_size(int fd, struct winsize *size) {
-    if (ioctl(fd, TIOCSWINSZ, size) != 0) {
+    if (ops->ioctl(fd, TIOCSWINSZ, size) != 0) {
         int errsv = errno;
         perror("Could not update current terminal size");
         errno = errsv;
@@ -143,15 +288,51 @@ static bool set_terminal_size(int fd, struct winsize *size) {
     return true;
 }
 
+static int get_font_height(int fd) {
+    /* Passing no data buffer makes the kernel return only the font's dimensions */
+    struct console_font_op op;
+    memset(&op, 0, sizeof(op));
+    op.op = KD_FONT_OP_GET;
+    op.width = UINT_MAX;
+    op.height = UINT_MAX;
+    op.data = NULL;
+
+    if (ops->ioctl(fd, KDFONTOP, &op) != 0 || op.height == 0) {
+        return -1;
+    }
+
+    return op.height;
+}
+
+static int rows_for_height(int fd, int height) {
+    int font_height = get_font_height(fd);
+    if (font_height <= 0) {
+        return -1;
+    }
+    return height / font_height;
+}
+
 static bool shrink_terminal(int fd) {
     struct winsize size = { 0, 0, 0, 0 };
-    
-    if (!reset_terminal(fd, &size)) {
+
+    int rows = rows_for_height(fd, console_height - keyboard_height);
+    if (rows < 0) {
+        /* Font unknown, fall back to probing */
+        if (!probe_and_reset_terminal(fd, &size)) {
+            perror("Could not shrink terminal size");
+            return false;
+        }
+        rows = floor((float)size.ws_row * height_factor);
+    } else if (!get_terminal_size(fd, &size)) {
         perror("Could not shrink terminal size");
         return false;
     }
 
-    size.ws_row = floor((float)size.ws_row * height_factor);
+    if (rows < 1 || size.ws_row == rows) {
+        return true;
+    }
+
+    size.ws_row = rows;
     if (!set_terminal_size(fd, &size)) {
         perror("Could not shrink terminal size");
         return false;
@@ -160,7 +341,93 @@ static bool shrink_terminal(int fd) {
     return true;
 }
 
-static bool reset_terminal(int fd, struct winsize *size) {
+static bool record_and_shrink_terminal(int vt, int fd) {
+    /* Persist the original size before shrinking so that it can be restored even if we crash right after */
+    if (!get_terminal_size(fd, &original_sizes[vt - 1])) {
+        return false;
+    }
+    resized_vts[vt - 1] = true;
+    save_state();
+
+    if (!shrink_terminal(fd)) {
+        resized_vts[vt - 1] = false;
+        save_state();
+        return false;
+    }
+
+    return true;
+}
+
+static void eager_resize_wake_handler(int signum) {
+}
+
+static void *eager_resize_worker(void *data) {
+    int state_fd = ops->open("/dev/tty0", O_RDWR | O_NOCTTY | O_CLOEXEC);
+    if (state_fd < 0) {
+        perror("Could not open /dev/tty0 for eager resizing");
+        atomic_store(&eager_resize_exited, true);
+        return NULL;
+    }
+
+    sigset_t wake_signal;
+    sigemptyset(&wake_signal);
+    sigaddset(&wake_signal, EAGER_RESIZE_WAKE_SIGNAL);
+    pthread_sigmask(SIG_UNBLOCK, &wake_signal, NULL);
+
+    struct pollfd wake = { .fd = eager_resize_wake_fd, .events = POLLIN, .revents = 0 };
+    bool can_wait_for_switch = true;
+    char device[16];
+
+    while (!atomic_load(&eager_resize_stopping)) {
+        struct vt_stat stat;
+        if (ops->ioctl(state_fd, VT_GETSTATE, &stat) != 0) {
+            perror("Could not retrieve terminal state for eager resizing");
+            stat.v_state = 0;
+        }
+
+        for (int vt = 1; vt <= MAX_STATE_VTS && vt <= MAX_NR_CONSOLES; ++vt) {
+            if (!(stat.v_state & (1 << vt))) {
+                continue; /* Not allocated */
+            }
+
+            pthread_mutex_lock(&lock);
+            if (!resized_vts[vt - 1]) {
+                snprintf(device, sizeof(device), "/dev/tty%d", vt);
+                int fd = ops->open(device, O_RDWR | O_NOCTTY | O_CLOEXEC);
+                if (fd >= 0) {
+                    if (!record_and_shrink_terminal(vt, fd)) {
+                        perror("Could not eagerly resize terminal");
+                    }
+                    ops->close(fd);
+                }
+            }
+            pthread_mutex_unlock(&lock);
+        }
+
+        /* VTs are usually allocated when they're switched to, so block until the next switch and scan again
+         * then. The wait ends early with EINTR when we're asked to stop. */
+        if (can_wait_for_switch) {
+            struct vt_event event = { .event = VT_EVENT_SWITCH };
+            if (ops->ioctl(state_fd, VT_WAITEVENT, &event) == 0 || errno == EINTR) {
+                continue;
+            }
+            perror("Could not wait for terminal switches, falling back to polling");
+            can_wait_for_switch = false;
+        }
+
+        /* Sleep until the next scan unless we're asked to stop */
+        int ret = poll(&wake, 1, EAGER_RESIZE_INTERVAL);
+        if (ret > 0 || (ret < 0 && errno != EINTR)) {
+            break;
+        }
+    }
+
+    ops->close(state_fd);
+    atomic_store(&eager_resize_exited, true);
+    return NULL;
+}
+
+static bool probe_and_reset_terminal(int fd, struct winsize *size) {
     if (!get_terminal_size(fd, size)) {
         perror("Could not reset terminal size");
         return false;
@@ -207,12 +474,101 @@ static bool reset_terminal(int fd, struct winsize *size) {
     return true;
 }
 
+static bool restore_terminal(int vt, struct winsize *size) {
+    char device[16];
+    snprintf(device, sizeof(device), "/dev/tty%d", vt);
+
+    int fd = ops->open(device, O_RDWR | O_NOCTTY);
+    if (fd < 0) {
+        perror("Could not reset TTY, unable to open TTY");
+        return false;
+    }
+
+    bool success = set_terminal_size(fd, size);
+    ops->close(fd);
+    return success;
+}
+
+static void save_state(void) {
+    bool any_resized = false;
+    for (int i = 0; i < MAX_NR_CONSOLES; ++i) {
+        any_resized |= resized_vts[i];
+    }
+
+    if (!any_resized) {
+        if (unlink(state_file) != 0 && errno != ENOENT) {
+            perror("Could not remove terminal state file");
+        }
+        return;
+    }
+
+    if (mkdir(state_dir, 0755) != 0 && errno != EEXIST) {
+        perror("Could not create state directory");
+        return;
+    }
+
+    /* Write to a temporary file and rename it so that the state file is never seen half-written */
+    char tmp_file[PATH_MAX + 4];
+    snprintf(tmp_file, sizeof(tmp_file), "%s.tmp", state_file);
+    FILE *file = fopen(tmp_file, "w");
+    if (!file) {
+        perror("Could not write terminal state file");
+        return;
+    }
+
+    for (int i = 0; i < MAX_NR_CONSOLES; ++i) {
+        if (resized_vts[i]) {
+            fprintf(file, "%d %hu %hu %hu %hu\n", i + 1, original_sizes[i].ws_row, original_sizes[i].ws_col,
+                original_sizes[i].ws_xpixel, original_sizes[i].ws_ypixel);
+        }
+    }
+
+    if (fclose(file) != 0 || rename(tmp_file, state_file) != 0) {
+        perror("Could not write terminal state file");
+        unlink(tmp_file);
+    }
+}
+
+static void restore_stale_state(void) {
+    FILE *file = fopen(state_file, "r");
+    if (!file) {
+        return;
+    }
+
+    int vt;
+    struct winsize size;
+    while (fscanf(file, "%d %hu %hu %hu %hu", &vt, &size.ws_row, &size.ws_col, &size.ws_xpixel, &size.ws_ypixel) == 5) {
+        if (vt < 1 || vt > MAX_NR_CONSOLES) {
+            continue;
+        }
+        restore_terminal(vt, &size);
+    }
+
+    fclose(file);
+    unlink(state_file);
+}
+
 
 /**
  * Public functions
  */
 
-bool bb_terminal_init(float factor) {
+void bb_terminal_set_ops(const bb_terminal_ops *new_ops, const char *new_state_dir) {
+    ops = new_ops;
+    snprintf(state_dir, sizeof(state_dir), "%s", new_state_dir);
+    snprintf(state_file, sizeof(state_file), "%s/%s", new_state_dir, STATE_FILE_NAME);
+}
+
+bool bb_terminal_init(int total_height, int occupied_height) {
+    /* Use the real VTs unless other operations were set up */
+    static const bb_terminal_ops default_ops = { default_open, close, default_ioctl };
+    if (!ops) {
+        ops = &default_ops;
+    }
+
+    /* Undo any resizing left over from a previous instance before recording original sizes again */
+    restore_stale_state();
+
     if (!reopen_current_terminal()) {
         perror("Could not prepare for terminal resizing");
         return false;
@@ -224,58 +580,139 @@ bool bb_terminal_init(float factor) {
         return false;
     }
 
-    height_factor = factor;
+    console_height = total_height;
+    keyboard_height = occupied_height;
+    height_factor = (float)(total_height - occupied_height) / (float)total_height;
     return true;
 }
 
+bool bb_terminal_start_eager_resize(void) {
+    if (eager_resize_running) {
+        return true;
+    }
+
+    /* Install the wake handler without SA_RESTART so that it interrupts VT_WAITEVENT */
+    struct sigaction action = { .sa_handler = eager_resize_wake_handler, .sa_flags = 0 };
+    sigemptyset(&action.sa_mask);
+    if (sigaction(EAGER_RESIZE_WAKE_SIGNAL, &action, NULL) != 0) {
+        perror("Could not start eager resizing");
+        return false;
+    }
+
+    eager_resize_wake_fd = eventfd(0, EFD_CLOEXEC);
+    if (eager_resize_wake_fd < 0) {
+        perror("Could not start eager resizing");
+        return false;
+    }
+
+    atomic_store(&eager_resize_stopping, false);
+    atomic_store(&eager_resize_exited, false);
+
+    if (pthread_create(&eager_resize_thread, NULL, eager_resize_worker, NULL) != 0) {
+        perror("Could not start eager resizing");
+        close(eager_resize_wake_fd);
+        eager_resize_wake_fd = -1;
+        return false;
+    }
+
+    eager_resize_running = true;
+    return true;
+}
+
+void bb_terminal_stop_eager_resize(void) {
+    if (!eager_resize_running) {
+        return;
+    }
+
+    atomic_store(&eager_resize_stopping, true);
+
+    uint64_t value = 1;
+    if (write(eager_resize_wake_fd, &value, sizeof(value)) != sizeof(value)) {
+        perror("Could not stop eager resizing");
+        return;
+    }
+
+    /* Interrupt a pending wait for a VT switch. The signal can arrive right before the worker starts
+     * waiting, so keep sending it until the worker is gone. */
+    const struct timespec wake_interval = { .tv_sec = 0, .tv_nsec = EAGER_RESIZE_WAKE_INTERVAL * 1000000L };
+    while (!atomic_load(&eager_resize_exited)) {
+        pthread_kill(eager_resize_thread, EAGER_RESIZE_WAKE_SIGNAL);
+        nanosleep(&wake_interval, NULL);
+    }
+
+    pthread_join(eager_resize_thread, NULL);
+    eager_resize_running = false;
+
+    close(eager_resize_wake_fd);
+    eager_resize_wake_fd = -1;
+}
+
 void bb_terminal_shrink_current(void) {
+    uint64_t start = bb_trace_begin();
+    pthread_mutex_lock(&lock);
+
     int active_vt = get_active_terminal();
     if (active_vt < 0) {
         perror("Could not resize current terminal");
-        return;
+        goto out;
     }
 
     if (active_vt < 0 || active_vt > MAX_NR_CONSOLES - 1) {
         perror("Could not resize current terminal, index is out of bounds");
-        return;
+        goto out;
     }
 
     if (resized_vts[active_vt - 1]) {
-        return; /* Already resized */
+        goto out; /* Already resized */
     }
 
     if (active_vt != current_vt) {
         if (!reopen_current_terminal()) {
             perror("Could not resize current terminal");
-            return;
+            goto out;
         }
         current_vt = active_vt;
     }
 
-    if (!shrink_terminal(current_fd)) {
+    if (!record_and_shrink_terminal(current_vt, current_fd)) {
         perror("Could not resize current terminal");
-        return;
     }
 
-    resized_vts[current_vt - 1] = true;
+out:
+    pthread_mutex_unlock(&lock);
+    bb_trace_end("terminal shrink", start);
 }
 
-void bb_terminal_reset_all(void) {
-    char device[16];
-    struct winsize size = { 0, 0, 0, 0 };
+void bb_terminal_log_state(void) {
+    pthread_mutex_lock(&lock);
 
+    bbx_log(BBX_LOG_LEVEL_ERROR, "Terminals: active VT %d, target height %d of %d px, eager resizing %s",
+        current_vt, console_height - keyboard_height, console_height, eager_resize_running ? "on" : "off");
     for (int i = 0; i < MAX_NR_CONSOLES; ++i) {
-        if (!resized_vts[i]) {
-            continue;
+        if (resized_vts[i]) {
+            bbx_log(BBX_LOG_LEVEL_ERROR, "  VT %d resized, originally %hu rows x %hu columns", i + 1,
+                original_sizes[i].ws_row, original_sizes[i].ws_col);
         }
+    }
+
+    pthread_mutex_unlock(&lock);
+}
+
+void bb_terminal_reset_all(void) {
+    bb_terminal_stop_eager_resize();
 
-        snprintf(device, 16, "/dev/tty%d", i + 1);
-        int fd = open(device, O_RDWR | O_NOCTTY);
-        if (fd < 0) {
-            perror("Could not reset TTY, unable to open TTY");
+    pthread_mutex_lock(&lock);
+
+    for (int i = 0; i < MAX_NR_CONSOLES; ++i) {
+        if (!resized_vts[i]) {
             continue;
         }
 
-        reset_terminal(fd, &size);
+        restore_terminal(i + 1, &original_sizes[i]);
+        resized_vts[i] = false;
     }
+
+    save_state();
+
+    pthread_mutex_unlock(&lock);
 }
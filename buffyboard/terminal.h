@@ -10,21 +10,64 @@
 #include <stdbool.h>
 
 /**
- * Prepare for resizing terminals by opening the current one.
+ * Operations for accessing terminal devices
+ */
+typedef struct {
+    /* Open a device as with open(2) */
+    int (*open)(const char *path, int flags);
+    /* Close a device as with close(2) */
+    int (*close)(int fd);
+    /* Perform an ioctl as with ioctl(2) */
+    int (*ioctl)(int fd, unsigned long request, void *arg);
+} bb_terminal_ops;
+
+/**
+ * Replace the operations for accessing terminal devices and the directory for the state file, e.g. to run
+ * against fake terminals. Must be called before bb_terminal_init.
+ *
+ * @param ops operations to use. Must stay valid for as long as terminals are being resized.
+ * @param state_dir directory for persisting the original sizes of resized terminals
+ */
+void bb_terminal_set_ops(const bb_terminal_ops *ops, const char *state_dir);
+
+/**
+ * Prepare for resizing terminals by opening the current one. The target row counts are computed
+ * from the given heights and each terminal's font height. Terminals that were left resized by a
+ * previous instance are restored to their original size.
  * 
- * @param factor factor (between 0 and 1) by which to adapt terminal sizes
+ * @param total_height height of the console in pixels
+ * @param occupied_height height in pixels at the bottom of the console that is covered by the keyboard
  * @return true if the operation was successful, false otherwise. No other bb_terminal_* functions
  * must be called if false is returned.
  */
-bool bb_terminal_init(float factor);
+bool bb_terminal_init(int total_height, int occupied_height);
 
 /**
- * Shrink the height of the active terminal by the current factor.
+ * Start shrinking all allocated VTs on a background thread so that switching VTs doesn't cause a
+ * visible resize. VTs that are allocated later on are picked up on the next VT switch. Only VTs 1
+ * to 15 are covered.
+ *
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_terminal_start_eager_resize(void);
+
+/**
+ * Stop shrinking VTs in the background. Terminals that were already shrunk are left as they are.
+ */
+void bb_terminal_stop_eager_resize(void);
+
+/**
+ * Shrink the height of the active terminal so that it doesn't overlap with the keyboard.
  */
 void bb_terminal_shrink_current(void);
 
 /**
- * Re-maximise the height of all previously resized terminals.
+ * Log which terminals are currently resized and their original sizes.
+ */
+void bb_terminal_log_state(void);
+
+/**
+ * Stop eager resizing and restore the original size of all previously resized terminals.
  */
 void bb_terminal_reset_all(void);
 
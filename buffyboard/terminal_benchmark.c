@@ -0,0 +1,225 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "terminal_benchmark.h"
+
+#include "clock.h"
+#include "fake_vt.h"
+#include "headless.h"
+#include "keyboard.h"
+#include "results.h"
+#include "terminal.h"
+
+#include "../shared/log.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+
+/**
+ * Defines
+ */
+
+/* Number of timed repetitions of each operation */
+#define NUM_ITERATIONS 100
+
+/* Number of VTs that are switched through in a resize storm */
+#define NUM_STORM_VTS 12
+
+
+/**
+ * Static types
+ */
+
+/* Console font */
+typedef struct {
+    /* Width in pixels */
+    int width;
+    /* Height in pixels */
+    int height;
+    /* Whether the font can be queried or the terminal size has to be probed for */
+    bool has_font_op;
+} font;
+
+/* Totals of an operation over all iterations */
+typedef struct {
+    /* Wall time in µs */
+    uint64_t time;
+    /* Counted operations */
+    bb_fake_vt_counters counters;
+} totals;
+
+
+/**
+ * Static variables
+ */
+
+/* Fonts typically used on low and high DPI screens and a driver without KDFONTOP support */
+static const font fonts[] = {
+    { 8, 16, true },
+    { 16, 32, true },
+    { 8, 16, false }
+};
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Add the counters accumulated since the last call and the time elapsed since a start time to totals.
+ *
+ * @param t totals to update
+ * @param start start time in µs
+ */
+static void accumulate(totals *t, uint64_t start);
+
+/**
+ * Write the averages of an operation to the results.
+ *
+ * @param results results file
+ * @param res console resolution
+ * @param f console font
+ * @param name name of the operation
+ * @param t totals of the operation
+ */
+static void write_result(bb_results *results, const bb_headless_resolution *res, const font *f,
+    const char *name, const totals *t);
+
+/**
+ * Check whether a VT has its original, full-screen size.
+ *
+ * @param vt number of the VT (e.g. 7 for /dev/tty7)
+ * @param res console resolution
+ * @param f console font
+ * @return true if the size is the original one, false otherwise
+ */
+static bool is_original_size(int vt, const bb_headless_resolution *res, const font *f);
+
+
+/**
+ * Static functions
+ */
+
+static void accumulate(totals *t, uint64_t start) {
+    t->time += bb_clock_now() - start;
+    bb_fake_vt_counters c;
+    bb_fake_vt_take_counters(&c);
+    t->counters.opens += c.opens;
+    t->counters.ioctls += c.ioctls;
+    t->counters.sigwinch += c.sigwinch;
+}
+
+static void write_result(bb_results *results, const bb_headless_resolution *res, const font *f,
+        const char *name, const totals *t) {
+    bb_results_add(results, "\"console\":\"%dx%d\",\"font\":\"%dx%d\",\"font_op\":%s,\"operation\":\"%s\","
+        "\"mean_us\":%.1f,\"opens\":%.1f,\"ioctls\":%.1f,\"sigwinch\":%.1f",
+        res->width, res->height, f->width, f->height, f->has_font_op ? "true" : "false", name,
+        (double)t->time / NUM_ITERATIONS, (double)t->counters.opens / NUM_ITERATIONS,
+        (double)t->counters.ioctls / NUM_ITERATIONS, (double)t->counters.sigwinch / NUM_ITERATIONS);
+}
+
+static bool is_original_size(int vt, const bb_headless_resolution *res, const font *f) {
+    struct winsize size;
+    bb_fake_vt_get_size(vt, &size);
+    return size.ws_row == res->height / f->height && size.ws_col == res->width / f->width;
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_terminal_benchmark_run(const char *path) {
+    char state_dir[] = "/tmp/buffyboard-benchmark-XXXXXX";
+    if (!mkdtemp(state_dir)) {
+        perror("Could not create state directory");
+        return false;
+    }
+    bb_terminal_set_ops(&bb_fake_vt_ops, state_dir);
+
+    bb_results results;
+    if (!bb_results_open(&results, path, NUM_ITERATIONS, NULL)) {
+        rmdir(state_dir);
+        return false;
+    }
+
+    bool success = true;
+    bb_fake_vt_counters ignored;
+    for (int r = 0; r < bb_headless_num_resolutions; ++r) {
+        const bb_headless_resolution *res = &bb_headless_resolutions[r];
+        int occupied_height = res->height / bb_keyboard_height_denominator(res->width, res->height);
+
+        for (size_t f = 0; f < sizeof(fonts) / sizeof(fonts[0]); ++f) {
+            totals shrink = { 0 };
+            totals reset = { 0 };
+            totals storm = { 0 };
+
+            for (int i = 0; i < NUM_ITERATIONS; ++i) {
+                /* Shrink and reset a single full-size terminal */
+                bb_fake_vt_init(res->width, res->height, fonts[f].width, fonts[f].height, fonts[f].has_font_op, 1);
+                bb_terminal_init(res->height, occupied_height);
+                bb_fake_vt_take_counters(&ignored);
+
+                uint64_t start = bb_clock_now();
+                bb_terminal_shrink_current();
+                accumulate(&shrink, start);
+
+                if (is_original_size(1, res, &fonts[f])) {
+                    bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: terminal wasn't shrunk on %dx%d console", res->width,
+                        res->height);
+                    success = false;
+                }
+
+                start = bb_clock_now();
+                bb_terminal_reset_all();
+                accumulate(&reset, start);
+
+                if (!is_original_size(1, res, &fonts[f])) {
+                    bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: terminal wasn't restored on %dx%d console", res->width,
+                        res->height);
+                    success = false;
+                }
+
+                /* Switch through many VTs and reset them all at once, as when cycling through consoles */
+                bb_fake_vt_init(res->width, res->height, fonts[f].width, fonts[f].height, fonts[f].has_font_op,
+                    NUM_STORM_VTS);
+                bb_terminal_init(res->height, occupied_height);
+                bb_fake_vt_take_counters(&ignored);
+
+                start = bb_clock_now();
+                for (int vt = 1; vt <= NUM_STORM_VTS; ++vt) {
+                    bb_fake_vt_set_active(vt);
+                    bb_terminal_shrink_current();
+                }
+                bb_terminal_reset_all();
+                accumulate(&storm, start);
+
+                for (int vt = 1; vt <= NUM_STORM_VTS; ++vt) {
+                    if (!is_original_size(vt, res, &fonts[f])) {
+                        bbx_log(BBX_LOG_LEVEL_ERROR, "FAIL: VT %d wasn't restored on %dx%d console", vt,
+                            res->width, res->height);
+                        success = false;
+                    }
+                }
+            }
+
+            write_result(&results, res, &fonts[f], "shrink", &shrink);
+            write_result(&results, res, &fonts[f], "reset", &reset);
+            write_result(&results, res, &fonts[f], "switch_storm", &storm);
+        }
+    }
+
+    rmdir(state_dir);
+
+    if (!bb_results_close(&results)) {
+        return false;
+    }
+
+    return success;
+}
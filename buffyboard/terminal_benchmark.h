@@ -0,0 +1,22 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_TERMINAL_BENCHMARK_H
+#define BB_TERMINAL_BENCHMARK_H
+
+#include <stdbool.h>
+
+/**
+ * Shrink and reset fake VTs with a range of console sizes and fonts and write the wall time, number of ioctls
+ * and number of SIGWINCH deliveries per operation as JSON. Fails if a terminal isn't restored to its original
+ * size.
+ *
+ * @param path path of the file to write the results to or NULL to write them to STDOUT
+ * @return true on success, false otherwise
+ */
+bool bb_terminal_benchmark_run(const char *path);
+
+#endif /* BB_TERMINAL_BENCHMARK_H */
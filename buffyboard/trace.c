@@ -0,0 +1,195 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#include "trace.h"
+
+#include "clock.h"
+
+#include "../shared/log.h"
+
+#include <limits.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <sys/syscall.h>
+
+
+/**
+ * Defines
+ */
+
+/* Number of events kept in the ring buffer (must be a power of two) */
+#define RING_SIZE (1 << 16)
+
+
+/**
+ * Static types
+ */
+
+/* Completed span. Slots are written and read concurrently, so every field is atomic. The payload fields are
+ * accessed with relaxed ordering and guarded by the sequence number, like a seqlock. */
+typedef struct {
+    /* Sequence number of the event plus one once it has been fully written, 0 before */
+    atomic_uint_fast64_t seq;
+    /* Name of the span */
+    _Atomic(const char *) name;
+    /* Start time in µs */
+    atomic_uint_fast64_t start;
+    /* Duration in µs */
+    atomic_uint_fast64_t duration;
+    /* ID of the thread that recorded the span */
+    atomic_int tid;
+} trace_event;
+
+
+/**
+ * Static variables
+ */
+
+/* Set after the ring buffer was allocated so that other threads only ever see an allocated buffer */
+static atomic_bool is_enabled = false;
+static const char *trace_path = NULL;
+static trace_event *ring = NULL;
+static atomic_uint_fast64_t next_seq = 0;
+static uint64_t refresh_start = 0;
+static uint64_t flush_start = 0;
+
+
+/**
+ * Static prototypes
+ */
+
+/**
+ * Handle refresh and flush events from the display.
+ *
+ * @param event the event object
+ */
+static void display_event_cb(lv_event_t *event);
+
+
+/**
+ * Static functions
+ */
+
+static void display_event_cb(lv_event_t *event) {
+    switch (lv_event_get_code(event)) {
+        case LV_EVENT_REFR_START:
+            refresh_start = bb_trace_begin();
+            break;
+        case LV_EVENT_REFR_READY:
+            bb_trace_end("refresh", refresh_start);
+            break;
+        case LV_EVENT_FLUSH_START:
+            flush_start = bb_trace_begin();
+            break;
+        case LV_EVENT_FLUSH_FINISH:
+            bb_trace_end("flush", flush_start);
+            break;
+        default:
+            break;
+    }
+}
+
+
+/**
+ * Public functions
+ */
+
+bool bb_trace_init(const char *path, lv_display_t *disp) {
+    ring = calloc(RING_SIZE, sizeof(trace_event));
+    if (!ring) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not allocate trace buffer");
+        return false;
+    }
+
+    trace_path = path;
+    atomic_store_explicit(&is_enabled, true, memory_order_release);
+
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_START, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_REFR_READY, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_FLUSH_START, NULL);
+    lv_display_add_event_cb(disp, display_event_cb, LV_EVENT_FLUSH_FINISH, NULL);
+
+    return true;
+}
+
+uint64_t bb_trace_begin(void) {
+    return atomic_load_explicit(&is_enabled, memory_order_acquire) ? bb_clock_now() : 0;
+}
+
+void bb_trace_end(const char *name, uint64_t start) {
+    if (start == 0) {
+        return;
+    }
+
+    uint64_t end = bb_clock_now();
+
+    /* Claim a slot without locking and mark it as being written. The fence keeps the payload stores from
+     * moving before that mark. The sequence number is published last with release ordering so that the flush
+     * sees the complete payload once it observes it. */
+    uint64_t seq = atomic_fetch_add_explicit(&next_seq, 1, memory_order_relaxed);
+    trace_event *event = &ring[seq & (RING_SIZE - 1)];
+    atomic_store_explicit(&event->seq, 0, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    atomic_store_explicit(&event->name, name, memory_order_relaxed);
+    atomic_store_explicit(&event->start, start, memory_order_relaxed);
+    atomic_store_explicit(&event->duration, end - start, memory_order_relaxed);
+    atomic_store_explicit(&event->tid, (int)syscall(SYS_gettid), memory_order_relaxed);
+    atomic_store_explicit(&event->seq, seq + 1, memory_order_release);
+}
+
+void bb_trace_flush(void) {
+    if (!atomic_load_explicit(&is_enabled, memory_order_acquire)) {
+        return;
+    }
+
+    char tmp_path[PATH_MAX];
+    snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", trace_path);
+    FILE *file = fopen(tmp_path, "we");
+    if (!file) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not write trace to %s", tmp_path);
+        return;
+    }
+
+    uint64_t end = atomic_load_explicit(&next_seq, memory_order_acquire);
+    uint64_t begin = (end > RING_SIZE) ? end - RING_SIZE : 0;
+    pid_t pid = getpid();
+    bool is_first = true;
+
+    fprintf(file, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[");
+    for (uint64_t seq = begin; seq < end; ++seq) {
+        trace_event *event = &ring[seq & (RING_SIZE - 1)];
+        if (atomic_load_explicit(&event->seq, memory_order_acquire) != seq + 1) {
+            continue; /* Still being written or already overwritten */
+        }
+
+        /* Copy the event and make sure that it wasn't overwritten in the meantime. The fence keeps the
+         * payload loads from moving past the second check. */
+        const char *name = atomic_load_explicit(&event->name, memory_order_relaxed);
+        uint64_t start = atomic_load_explicit(&event->start, memory_order_relaxed);
+        uint64_t duration = atomic_load_explicit(&event->duration, memory_order_relaxed);
+        int tid = atomic_load_explicit(&event->tid, memory_order_relaxed);
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&event->seq, memory_order_relaxed) != seq + 1) {
+            continue;
+        }
+
+        fprintf(file, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%llu,\"dur\":%llu,\"pid\":%d,\"tid\":%d}",
+            is_first ? "" : ",", name, (unsigned long long)start, (unsigned long long)duration, (int)pid, tid);
+        is_first = false;
+    }
+    fprintf(file, "\n]}\n");
+
+    if (fclose(file) != 0 || rename(tmp_path, trace_path) != 0) {
+        bbx_log(BBX_LOG_LEVEL_ERROR, "Could not write trace to %s", trace_path);
+        unlink(tmp_path);
+        return;
+    }
+
+    bbx_log(BBX_LOG_LEVEL_VERBOSE, "Wrote %llu trace events to %s", (unsigned long long)(end - begin), trace_path);
+}
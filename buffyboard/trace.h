@@ -0,0 +1,46 @@
+/**
+ * Copyright 2026 Johannes Marbach
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+
+#ifndef BB_TRACE_H
+#define BB_TRACE_H
+
+#include "lvgl/lvgl.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * Start recording trace events into an in-memory ring buffer. Once the buffer is full, the oldest events
+ * are overwritten.
+ *
+ * @param path path of the file to write the trace to when flushing
+ * @param disp display to record refresh and flush spans for
+ * @return true if the operation was successful, false otherwise
+ */
+bool bb_trace_init(const char *path, lv_display_t *disp);
+
+/**
+ * Record the start of a span. Can be called from any thread.
+ *
+ * @return start timestamp to pass to bb_trace_end or 0 if tracing is disabled
+ */
+uint64_t bb_trace_begin(void);
+
+/**
+ * Record the end of a span. Can be called from any thread.
+ *
+ * @param name name of the span (must be a string literal)
+ * @param start start timestamp returned by bb_trace_begin
+ */
+void bb_trace_end(const char *name, uint64_t start);
+
+/**
+ * Write all events currently in the ring buffer to the trace file in Chrome's trace event format. The
+ * file can be opened in chrome://tracing or the Perfetto UI. Does nothing if tracing is disabled.
+ */
+void bb_trace_flush(void);
+
+#endif /* BB_TRACE_H */
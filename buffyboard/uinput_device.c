@@ -6,6 +6,8 @@
 
 #include "uinput_device.h"
 
+#include "trace.h"
+
 #include <fcntl.h>
 #include <stdio.h>
 #include <string.h>
@@ -20,6 +22,10 @@
 
 static int fd = -1;
 struct input_event event;
+static struct input_event batch[2 * BB_UINPUT_DEVICE_MAX_BATCH];
+
+/* Scancodes the device was set up with. The kernel silently drops all others. */
+static bool is_registered[KEY_MAX + 1];
 
 
 /**
@@ -41,6 +47,14 @@ static bool uinput_device_emit(int type, int code, int value);
  */
 static bool uinput_device_synchronise();
 
+/**
+ * Remember the scancodes the device can emit.
+ *
+ * @param scancodes array of scancodes
+ * @param num_scancodes number of scancodes
+ */
+static void register_scancodes(const int * const scancodes, int num_scancodes);
+
 
 /**
  * Static functions
@@ -53,7 +67,11 @@ static bool uinput_device_emit(int type, int code, int value) {
     event.input_event_sec = 0;
     event.input_event_usec = 0;
 
-    if (write(fd, &event, sizeof(event)) != sizeof(event)) {
+    uint64_t start = bb_trace_begin();
+    ssize_t written = write(fd, &event, sizeof(event));
+    bb_trace_end("uinput write", start);
+
+    if (written != sizeof(event)) {
         perror("Could not emit event");
         return false;
     }
@@ -65,6 +83,15 @@ static bool uinput_device_synchronise() {
     return uinput_device_emit(EV_SYN, SYN_REPORT, 0);
 }
 
+static void register_scancodes(const int * const scancodes, int num_scancodes) {
+    memset(is_registered, 0, sizeof(is_registered));
+    for (int i = 0; i < num_scancodes; ++i) {
+        if (scancodes[i] >= 0 && scancodes[i] <= KEY_MAX) {
+            is_registered[scancodes[i]] = true;
+        }
+    }
+}
+
 
 /**
  * Public functions
@@ -93,6 +120,7 @@ bool bb_uinput_device_init(const int * const scancodes, int num_scancodes) {
             return false;
         }
     }
+    register_scancodes(scancodes, num_scancodes);
 
     struct uinput_user_dev device;
 	memset(&device, 0, sizeof(device));
@@ -117,6 +145,15 @@ bool bb_uinput_device_init(const int * const scancodes, int num_scancodes) {
     return true;
 }
 
+bool bb_uinput_device_get_sysname(char *name, size_t size) {
+    if (ioctl(fd, UI_GET_SYSNAME(size), name) < 0) {
+        perror("Could not get sysfs name of uinput device");
+        return false;
+    }
+
+    return true;
+}
+
 bool bb_uinput_device_emit_key_down(int scancode) {
     return uinput_device_emit(EV_KEY, scancode, 1) && uinput_device_synchronise();
 }
@@ -124,3 +161,36 @@ bool bb_uinput_device_emit_key_down(int scancode) {
 bool bb_uinput_device_emit_key_up(int scancode) {
     return uinput_device_emit(EV_KEY, scancode, 0) && uinput_device_synchronise();
 }
+
+bool bb_uinput_device_can_emit(int scancode) {
+    return scancode >= 0 && scancode <= KEY_MAX && is_registered[scancode];
+}
+
+bool bb_uinput_device_emit_keys(const bb_uinput_device_key_event *events, int num_events) {
+    if (num_events > BB_UINPUT_DEVICE_MAX_BATCH) {
+        fprintf(stderr, "Could not emit events: %d key events exceed the batch size\n", num_events);
+        return false;
+    }
+
+    memset(batch, 0, 2 * num_events * sizeof(struct input_event));
+    for (int i = 0; i < num_events; ++i) {
+        batch[2 * i].type = EV_KEY;
+        batch[2 * i].code = events[i].scancode;
+        batch[2 * i].value = events[i].pressed ? 1 : 0;
+        batch[2 * i + 1].type = EV_SYN;
+        batch[2 * i + 1].code = SYN_REPORT;
+    }
+
+    /* uinput processes all events of a write at once, so a whole batch costs a single syscall */
+    size_t size = 2 * num_events * sizeof(struct input_event);
+    uint64_t trace_start = bb_trace_begin();
+    ssize_t written = write(fd, batch, size);
+    bb_trace_end("uinput write", trace_start);
+
+    if (written != (ssize_t)size) {
+        perror("Could not emit events");
+        return false;
+    }
+
+    return true;
+}
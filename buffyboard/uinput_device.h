@@ -8,6 +8,23 @@
 #define BB_UINPUT_DEVICE_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Maximum number of key events that may be emitted at once. Including their synchronisation events, they fill half
+ * of the 64 events that evdev buffers for each reader of a keyboard, and readers that fall further behind lose
+ * events. Longer sequences must be split and the main loop given a chance to run in between. */
+#define BB_UINPUT_DEVICE_MAX_BATCH 16
+
+/**
+ * Key event for emitting in a batch
+ */
+typedef struct {
+    /* The key's scancode */
+    uint16_t scancode;
+    /* true for a key down event, false for a key up event */
+    bool pressed;
+} bb_uinput_device_key_event;
 
 /**
  * Initialise the uinput keyboard device
@@ -18,6 +35,15 @@
  */
 bool bb_uinput_device_init(const int * const scancodes, int num_scancodes);
 
+/**
+ * Retrieve the sysfs name (e.g. "input12") of the uinput keyboard device
+ *
+ * @param name buffer for writing the name into
+ * @param size size of the buffer
+ * @return true if retrieving the name was successful, false otherwise
+ */
+bool bb_uinput_device_get_sysname(char *name, size_t size);
+
 /**
  * Emit a key down event
  * 
@@ -34,4 +60,21 @@ bool bb_uinput_device_emit_key_down(int scancode);
  */
 bool bb_uinput_device_emit_key_up(int scancode);
 
+/**
+ * Check whether the device was set up with a scancode. Events for other scancodes are dropped by the kernel.
+ *
+ * @param scancode the key's scancode
+ * @return true if the device can emit the scancode, false otherwise
+ */
+bool bb_uinput_device_can_emit(int scancode);
+
+/**
+ * Emit a sequence of key events, each followed by a synchronisation event, with a single write
+ *
+ * @param events key events to emit in order
+ * @param num_events number of key events, at most BB_UINPUT_DEVICE_MAX_BATCH
+ * @return true if emitting the events was successful, false otherwise
+ */
+bool bb_uinput_device_emit_keys(const bb_uinput_device_key_event *events, int num_events);
+
 #endif /* BB_UINPUT_DEVICE_H */